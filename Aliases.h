@@ -1,8 +1,38 @@
 #pragma once
 
 #include <vector>
+#include <cstdint>
 
-using Price = std::int32_t;
-using Quantity = std::uint32_t;
+// Note(vss): the integer types orders carry their price in ticks and their quantity in. Level totals stay 32 bit under either.
+struct WideTypes
+{
+	using Price = std::int32_t;
+	using Quantity = std::uint32_t;
+};
+
+struct NarrowTypes
+{
+	using Price = std::int16_t;
+	using Quantity = std::uint16_t;
+};
+
+/**
+* Define ORDERBOOK_NARROW_TYPES for every translation unit to build the book on NarrowTypes, for instruments whose prices
+* and order sizes fit 16 bits. Journals and snapshots keep 32 bit fields under either policy, so files move between builds.
+*/
+#if defined(ORDERBOOK_NARROW_TYPES)
+using TypePolicy = NarrowTypes;
+#else
+using TypePolicy = WideTypes;
+#endif
+
+using Price = TypePolicy::Price;
+using Quantity = TypePolicy::Quantity;
+// Note(vss): quantity and order count summed over a level.
+using LevelQuantity = std::uint32_t;
 using OrderId = std::uint64_t;
-using OrderIds = std::vector<OrderId>;
\ No newline at end of file
+using OrderIds = std::vector<OrderId>;
+using OrderHandle = std::uint32_t;
+using SymbolId = std::uint32_t;
+// Note(vss): nanoseconds since the Unix epoch on the system clock, zero means never.
+using Timestamp = std::int64_t;
\ No newline at end of file
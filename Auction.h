@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+#include "Aliases.h"
+
+// Continuous, Auction
+enum class SessionState : std::uint8_t
+{
+	Continuous, // incoming orders trade as soon as they cross
+	Auction,    // a call phase, orders accumulate without trading until the book is uncrossed
+};
+
+/**
+* @brief Where a call auction uncrosses: the price that executes the most quantity and, among those, leaves the smallest imbalance.
+* buyQuantity_ and sellQuantity_ are what bids and asks are willing to trade at price_, quantity_ is the smaller of the two.
+*/
+struct AuctionUncross
+{
+	Price price_{};
+	std::uint64_t quantity_{};
+	std::uint64_t buyQuantity_{};
+	std::uint64_t sellQuantity_{};
+
+	// Note(vss): what is left unexecuted at price_, on the side with the surplus.
+	std::uint64_t GetImbalance() const { return std::max(buyQuantity_, sellQuantity_) - quantity_; }
+};
\ No newline at end of file
@@ -0,0 +1,635 @@
+#pragma once
+
+#include <bit>
+#include <map>
+#include <array>
+#include <algorithm>
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <format>
+#include <memory_resource>
+
+#include "Aliases.h"
+#include "SideTraits.h"
+#include "LevelInfo.h"
+#include "PriceLevel.h"
+#include "LevelScan.h"
+#include "QuantityTrie.h"
+#include "OrderbookSettings.h"
+#include "OrderbookMemoryUsage.h"
+
+/**
+* @brief One side of the book: the price levels of either the bids or the asks, best price first as SideTraits<S>::Compare orders them.
+* Without LadderSettings every level lives in a sparse map. With them, levels inside the band live in a
+* contiguous array indexed by tick and a two level occupancy bitmap is used to find the next non empty level,
+* so the best and worst prices are tracked incrementally instead of walking a tree.
+* Resting quantity is also summed per side, per tick in a Fenwick tree over the ladder and per price in a QuantityTrie over the
+* sparse levels, so the quantity reachable up to a limit price is a logarithmic query instead of a walk over the levels. The ladder's quantities are mirrored into one
+* contiguous array ordered best tick first, which depth reads and sweep searches scan with the LevelScan.h kernels without touching the levels themselves.
+*/
+template <Side S>
+class BookSide
+{
+public:
+
+	using Compare = typename SideTraits<S>::Compare;
+
+	BookSide(std::pmr::memory_resource* resource, const std::optional<LadderSettings>& ladder) :
+		sparse_{ resource },
+		levels_{ resource }
+	{
+		if (!ladder.has_value())
+		{
+			return;
+		}
+
+		const auto& [tickSize, minPrice, maxPrice] = ladder.value();
+		if (tickSize <= 0 || maxPrice < minPrice || (static_cast<std::int64_t>(maxPrice) - minPrice) % tickSize != 0)
+		{
+			throw std::logic_error(std::format("Invalid ladder band [{}, {}] with tick size ({}).", minPrice, maxPrice, tickSize));
+		}
+
+		tickSize_ = tickSize;
+		minPrice_ = minPrice;
+		maxPrice_ = maxPrice;
+
+		const auto size = static_cast<std::size_t>((static_cast<std::int64_t>(maxPrice) - minPrice) / tickSize) + 1;
+		levels_.resize(size);
+		depth_.resize(size);
+		cumulative_.resize(size + 1);
+		words_.resize((size + 63) / 64);
+		summary_.resize((words_.size() + 63) / 64);
+	}
+
+	BookSide(const BookSide&) = delete;
+	void operator=(const BookSide&) = delete;
+
+	bool Empty() const { return ladderCount_ == 0 && sparse_.empty(); }
+	std::size_t LevelCount() const { return ladderCount_ + sparse_.size(); }
+
+	// Note(vss): walks every level, vacated ladder levels included since their queues keep what they have grown to.
+	std::size_t MemoryUsage() const
+	{
+		auto bytes = levels_.capacity() * sizeof(PriceLevel) + depth_.capacity() * sizeof(LevelQuantity) +
+			(cumulative_.capacity() + words_.capacity() + summary_.capacity()) * sizeof(std::uint64_t) +
+			sparse_.size() * (sizeof(typename decltype(sparse_)::value_type) + MapNodeOverhead) + sparseQuantity_.MemoryUsage();
+		for (const auto& level : levels_)
+		{
+			bytes += level.orders_.MemoryUsage();
+		}
+		for (const auto& [price, level] : sparse_)
+		{
+			bytes += level.orders_.MemoryUsage();
+		}
+		return bytes;
+	}
+
+	Price BestPrice() const
+	{
+		return IsLadderBest() ? ToPrice(best_) : sparse_.begin()->first;
+	}
+
+	Price WorstPrice() const
+	{
+		return IsLadderWorst() ? ToPrice(worst_) : sparse_.rbegin()->first;
+	}
+
+	PriceLevel& BestLevel()
+	{
+		return IsLadderBest() ? levels_[best_] : sparse_.begin()->second;
+	}
+
+	const PriceLevel& BestLevel() const
+	{
+		return IsLadderBest() ? levels_[best_] : sparse_.begin()->second;
+	}
+
+	// Note(vss): finds or creates the level, like std::map::operator[].
+	PriceLevel& operator[](Price price)
+	{
+		if (!IsInBand(price))
+		{
+			return sparse_[price];
+		}
+
+		const auto index = ToIndex(price);
+		if (!IsOccupied(index))
+		{
+			Occupy(index);
+		}
+
+		return levels_[index];
+	}
+
+	PriceLevel* Find(Price price)
+	{
+		if (!IsInBand(price))
+		{
+			auto level = sparse_.find(price);
+			return level == sparse_.end() ? nullptr : &level->second;
+		}
+
+		const auto index = ToIndex(price);
+		return IsOccupied(index) ? &levels_[index] : nullptr;
+	}
+
+	void Erase(Price price)
+	{
+		if (!IsInBand(price))
+		{
+			sparse_.erase(price);
+			return;
+		}
+
+		const auto index = ToIndex(price);
+		if (IsOccupied(index))
+		{
+			Vacate(index);
+		}
+	}
+
+	// Note(vss): called whenever resting quantity at price changes, change is negative for cancels and fills.
+	void OnQuantityChanged(Price price, std::int64_t change)
+	{
+		totalQuantity_ += static_cast<std::uint64_t>(change);
+		if (!IsInBand(price))
+		{
+			sparseQuantity_.Add(price, change);
+			return;
+		}
+
+		ladderQuantity_ += static_cast<std::uint64_t>(change);
+		depth_[ToRank(ToIndex(price))] += static_cast<LevelQuantity>(change);
+		for (auto index = ToIndex(price) + 1; index < cumulative_.size(); index += index & (~index + 1))
+		{
+			cumulative_[index] += static_cast<std::uint64_t>(change);
+		}
+	}
+
+	/**
+	* @brief True if levels priced at limit or better hold at least quantity between them.
+	* A side that holds too little overall, or that lies entirely within limit, is answered straight from the total.
+	* Otherwise the ladder part comes from its Fenwick tree and the sparse part from its trie, no level is visited.
+	*/
+	bool HasQuantity(Price limit, std::uint64_t quantity) const
+	{
+		if (Empty() || totalQuantity_ < quantity)
+		{
+			return false;
+		}
+		if (!Compare{}(limit, WorstPrice()))
+		{
+			return true;
+		}
+
+		return GetLadderQuantity(limit) + GetSparseQuantity(limit) >= quantity;
+	}
+
+	/**
+	* @brief Visits every level from the best price to the worst price as function(price, level).
+	* Returning false from function stops the walk.
+	*/
+	template <typename Function>
+	void ForEachLevel(Function&& function) const
+	{
+		WalkLevels(
+			[&](std::size_t index) { return function(ToPrice(index), levels_[index]); },
+			[&](Price price, const PriceLevel& level) { return function(price, level); });
+	}
+
+	// Note(vss): same walk as ForEachLevel as function(price, quantity), ladder quantities come from the contiguous depth array.
+	template <typename Function>
+	void ForEachQuantity(Function&& function) const
+	{
+		WalkLevels(
+			[&](std::size_t index) { return function(ToPrice(index), depth_[ToRank(index)]); },
+			[&](Price price, const PriceLevel& level) { return function(price, level.data_.quantity_); });
+	}
+
+	/**
+	* @brief Same walk as ForEachQuantity for reads that go deep into the side. On a ladder with at least a scan block of levels
+	* and quantity at one tick in DenseShare or more, ticks are found a block at a time with FindNonZero, which is about 1.6 times
+	* as fast there. Smaller or sparser ladders keep the bitmap walk, since most of each block would be scanned for nothing.
+	*/
+	template <typename Function>
+	void ScanQuantities(Function&& function) const
+	{
+		if (IsLadderDense())
+		{
+			ScanLadder(function);
+		}
+		else
+		{
+			ForEachQuantity(function);
+		}
+	}
+
+	// Note(vss): copies the best levels.size() levels best first and returns how many, copies shorter than a scan block take the bitmap walk.
+	std::size_t CopyDepth(std::span<LevelInfo> levels) const
+	{
+		std::size_t count{};
+		if (levels.empty())
+		{
+			return count;
+		}
+
+		auto Copy = [&](Price price, LevelQuantity quantity)
+			{
+				levels[count++] = LevelInfo{ price, quantity };
+				return count < levels.size();
+			};
+		if (levels.size() < ScanBlock)
+		{
+			ForEachQuantity(Copy);
+		}
+		else
+		{
+			ScanQuantities(Copy);
+		}
+		return count;
+	}
+
+	/**
+	* @brief The worst price an incoming order has to reach on this side to be filled for quantity, nullopt if the side holds less.
+	* The ladder ticks between one sparse level and the next are summed with FindCumulative straight from the depth array, empty ticks
+	* included, and each sparse level is added on its own, so the cost grows with the ticks and sparse levels the sweep covers.
+	*/
+	std::optional<Price> FindSweepPrice(std::uint64_t quantity) const
+	{
+		quantity = std::max<std::uint64_t>(quantity, 1);
+		if (Empty() || totalQuantity_ < quantity)
+		{
+			return std::nullopt;
+		}
+
+		std::uint64_t total{};
+		auto rank = ladderCount_ == 0 ? depth_.size() : ToRank(best_);
+		for (auto level = sparse_.begin();; ++level)
+		{
+			const auto end = level == sparse_.end() ? depth_.size() : std::max(rank, CountBetterRanks(level->first));
+			const auto found = rank + FindCumulative(depth_.data() + rank, end - rank, quantity, total);
+			if (found != end)
+			{
+				return ToPrice(ToRank(found));
+			}
+			rank = end;
+
+			if (level == sparse_.end())
+			{
+				return std::nullopt;
+			}
+			total += level->second.data_.quantity_;
+			if (total >= quantity)
+			{
+				return level->first;
+			}
+		}
+	}
+
+private:
+
+	static constexpr bool IsDescending = Compare{}(1, 0);
+	static constexpr std::size_t NoLevel = static_cast<std::size_t>(-1);
+	static constexpr std::uint64_t AllBits = ~std::uint64_t{};
+	// Note(vss): ticks ScanLadder hands to FindNonZero at once, a block that comes back empty is a gap for the bitmap to skip.
+	static constexpr std::size_t ScanBlock = 64;
+	static constexpr std::size_t DenseShare = 2;
+
+	std::pmr::map<Price, PriceLevel, Compare> sparse_;
+	QuantityTrie sparseQuantity_;
+
+	Price tickSize_{ 1 };
+	Price minPrice_{};
+	Price maxPrice_{};
+	std::pmr::vector<PriceLevel> levels_;
+	// Note(vss): quantity resting at each ladder tick, indexed by ToRank so the best tick comes first on either side.
+	std::vector<LevelQuantity> depth_;
+	// Note(vss): Fenwick tree of the quantity resting at each ladder index, one based.
+	std::vector<std::uint64_t> cumulative_;
+	std::uint64_t ladderQuantity_{};
+	std::uint64_t totalQuantity_{};
+	std::vector<std::uint64_t> words_;
+	std::vector<std::uint64_t> summary_;
+	std::size_t ladderCount_{};
+	std::size_t best_{ NoLevel };
+	std::size_t worst_{ NoLevel };
+
+	/**
+	* @brief Same walk as ForEachQuantity. Ladder ticks are found by FindNonZero over the depth array, ScanBlock ticks at a time from the best one, and a block with nothing
+	* in it hands over to the occupancy bitmap to jump the rest of the gap. Sparse levels are merged in by price as the walk reaches them.
+	*/
+	template <typename Function>
+	void ScanLadder(Function&& function) const
+	{
+		std::array<std::uint32_t, ScanBlock> offsets;
+		std::size_t found{};
+		std::size_t next{};
+		std::size_t block{};
+		auto rank = ladderCount_ == 0 ? depth_.size() : ToRank(best_);
+		auto level = sparse_.begin();
+
+		while (true)
+		{
+			while (next == found && rank < depth_.size())
+			{
+				block = rank;
+				const auto count = std::min(ScanBlock, depth_.size() - rank);
+				found = FindNonZero(depth_.data() + rank, count, offsets.data(), offsets.size());
+				next = 0;
+				rank += count;
+				if (found == 0 && rank < depth_.size())
+				{
+					const auto index = FindWorse(ToRank(rank - 1));
+					rank = index == NoLevel ? depth_.size() : ToRank(index);
+				}
+			}
+
+			if (next != found)
+			{
+				const auto ladderRank = block + offsets[next];
+				const auto price = ToPrice(ToRank(ladderRank));
+				if (level == sparse_.end() || Compare{}(price, level->first))
+				{
+					++next;
+					if (!function(price, depth_[ladderRank]))
+					{
+						return;
+					}
+					continue;
+				}
+			}
+			else if (level == sparse_.end())
+			{
+				return;
+			}
+
+			if (!function(level->first, level->second.data_.quantity_))
+			{
+				return;
+			}
+			++level;
+		}
+	}
+
+	// Note(vss): off tick prices inside the band are sparse too, so the two sources are merged rather than concatenated.
+	template <typename Ladder, typename Sparse>
+	void WalkLevels(Ladder&& ladder, Sparse&& sparse) const
+	{
+		auto level = sparse_.begin();
+		auto index = ladderCount_ == 0 ? NoLevel : best_;
+
+		while (index != NoLevel || level != sparse_.end())
+		{
+			const bool takeLadder = index != NoLevel && (level == sparse_.end() || Compare{}(ToPrice(index), level->first));
+			if (takeLadder)
+			{
+				if (!ladder(index))
+				{
+					return;
+				}
+				index = FindWorse(index);
+			}
+			else
+			{
+				if (!sparse(level->first, level->second))
+				{
+					return;
+				}
+				++level;
+			}
+		}
+	}
+
+	bool IsInBand(Price price) const
+	{
+		return !levels_.empty() && price >= minPrice_ && price <= maxPrice_ &&
+			(static_cast<std::int64_t>(price) - minPrice_) % tickSize_ == 0;
+	}
+
+	// Note(vss): maps a ladder index to its position in depth_ and back, bids are stored from the top of the band down.
+	std::size_t ToRank(std::size_t index) const { return IsDescending ? levels_.size() - 1 - index : index; }
+
+	std::size_t ToIndex(Price price) const { return static_cast<std::size_t>((static_cast<std::int64_t>(price) - minPrice_) / tickSize_); }
+	Price ToPrice(std::size_t index) const { return static_cast<Price>(minPrice_ + static_cast<std::int64_t>(index) * tickSize_); }
+
+	// Note(vss): how many ranks, counted from the best end of the band, hold ticks priced better than price.
+	std::size_t CountBetterRanks(Price price) const
+	{
+		const auto offset = static_cast<std::int64_t>(price) - minPrice_;
+		const auto size = static_cast<std::int64_t>(levels_.size());
+		if (IsDescending)
+		{
+			const auto notAbove = offset < 0 ? 0 : std::min(size, offset / tickSize_ + 1);
+			return static_cast<std::size_t>(size - notAbove);
+		}
+		return static_cast<std::size_t>(offset <= 0 ? 0 : std::min(size, (offset + tickSize_ - 1) / tickSize_));
+	}
+
+	// Note(vss): quantity resting at the first count ladder indices.
+	std::uint64_t GetPrefixQuantity(std::size_t count) const
+	{
+		std::uint64_t quantity{};
+		for (; count != 0; count &= count - 1)
+		{
+			quantity += cumulative_[count];
+		}
+		return quantity;
+	}
+
+	// Note(vss): quantity resting on sparse levels priced at limit or better.
+	std::uint64_t GetSparseQuantity(Price limit) const
+	{
+		if (IsDescending)
+		{
+			return sparseQuantity_.GetQuantity() - sparseQuantity_.GetQuantityBelow(limit, false);
+		}
+		return sparseQuantity_.GetQuantityBelow(limit, true);
+	}
+
+	// Note(vss): quantity resting on ladder levels priced at limit or better.
+	std::uint64_t GetLadderQuantity(Price limit) const
+	{
+		if (levels_.empty())
+		{
+			return 0;
+		}
+
+		const auto offset = static_cast<std::int64_t>(limit) - minPrice_;
+		if (IsDescending)
+		{
+			if (limit > maxPrice_)
+			{
+				return 0;
+			}
+			if (limit <= minPrice_)
+			{
+				return ladderQuantity_;
+			}
+			return ladderQuantity_ - GetPrefixQuantity(static_cast<std::size_t>((offset + tickSize_ - 1) / tickSize_));
+		}
+
+		if (limit < minPrice_)
+		{
+			return 0;
+		}
+		if (limit >= maxPrice_)
+		{
+			return ladderQuantity_;
+		}
+		return GetPrefixQuantity(static_cast<std::size_t>(offset / tickSize_) + 1);
+	}
+
+	bool IsOccupied(std::size_t index) const { return (words_[index >> 6] >> (index & 63)) & 1; }
+
+	// Note(vss): "better" and "worse" are in terms of priority, for bids a better level has a higher index.
+	bool IsBetter(std::size_t lhs, std::size_t rhs) const { return IsDescending ? lhs > rhs : lhs < rhs; }
+	std::size_t FindWorse(std::size_t index) const
+	{
+		if (IsDescending)
+		{
+			return index == 0 ? NoLevel : FindPrevious(index - 1);
+		}
+		return FindNext(index + 1);
+	}
+	std::size_t FindBetter(std::size_t index) const
+	{
+		if (IsDescending)
+		{
+			return FindNext(index + 1);
+		}
+		return index == 0 ? NoLevel : FindPrevious(index - 1);
+	}
+
+	bool IsLadderDense() const
+	{
+		return ladderCount_ >= ScanBlock && ladderCount_ * DenseShare >= ToRank(worst_) - ToRank(best_) + 1;
+	}
+
+	bool IsLadderBest() const
+	{
+		return ladderCount_ != 0 && (sparse_.empty() || Compare{}(ToPrice(best_), sparse_.begin()->first));
+	}
+
+	bool IsLadderWorst() const
+	{
+		return ladderCount_ != 0 && (sparse_.empty() || Compare{}(sparse_.rbegin()->first, ToPrice(worst_)));
+	}
+
+	void Occupy(std::size_t index)
+	{
+		const auto word = index >> 6;
+		words_[word] |= std::uint64_t{ 1 } << (index & 63);
+		summary_[word >> 6] |= std::uint64_t{ 1 } << (word & 63);
+
+		if (ladderCount_++ == 0)
+		{
+			best_ = worst_ = index;
+			return;
+		}
+
+		if (IsBetter(index, best_))
+		{
+			best_ = index;
+		}
+		if (IsBetter(worst_, index))
+		{
+			worst_ = index;
+		}
+	}
+
+	void Vacate(std::size_t index)
+	{
+		const auto word = index >> 6;
+		words_[word] &= ~(std::uint64_t{ 1 } << (index & 63));
+		if (words_[word] == 0)
+		{
+			summary_[word >> 6] &= ~(std::uint64_t{ 1 } << (word & 63));
+		}
+		// Note(vss): the emptied queue keeps its ring, so a level that fills up again does not allocate.
+		levels_[index].data_ = LevelData{ };
+
+		if (--ladderCount_ == 0)
+		{
+			best_ = worst_ = NoLevel;
+			return;
+		}
+
+		if (index == best_)
+		{
+			best_ = FindWorse(index);
+		}
+		if (index == worst_)
+		{
+			worst_ = FindBetter(index);
+		}
+	}
+
+	// Note(vss): lowest occupied index >= index.
+	std::size_t FindNext(std::size_t index) const
+	{
+		auto word = index >> 6;
+		if (word >= words_.size())
+		{
+			return NoLevel;
+		}
+
+		if (const auto bits = words_[word] & (AllBits << (index & 63)))
+		{
+			return (word << 6) + std::countr_zero(bits);
+		}
+
+		++word;
+		auto summaryWord = word >> 6;
+		if (summaryWord >= summary_.size())
+		{
+			return NoLevel;
+		}
+
+		auto summaryBits = summary_[summaryWord] & (AllBits << (word & 63));
+		while (summaryBits == 0)
+		{
+			if (++summaryWord >= summary_.size())
+			{
+				return NoLevel;
+			}
+			summaryBits = summary_[summaryWord];
+		}
+
+		word = (summaryWord << 6) + std::countr_zero(summaryBits);
+		return (word << 6) + std::countr_zero(words_[word]);
+	}
+
+	// Note(vss): highest occupied index <= index.
+	std::size_t FindPrevious(std::size_t index) const
+	{
+		auto word = index >> 6;
+
+		if (const auto bits = words_[word] & (AllBits >> (63 - (index & 63))))
+		{
+			return (word << 6) + 63 - std::countl_zero(bits);
+		}
+
+		if (word == 0)
+		{
+			return NoLevel;
+		}
+
+		--word;
+		auto summaryWord = word >> 6;
+		auto summaryBits = summary_[summaryWord] & (AllBits >> (63 - (word & 63)));
+		while (summaryBits == 0)
+		{
+			if (summaryWord == 0)
+			{
+				return NoLevel;
+			}
+			summaryBits = summary_[--summaryWord];
+		}
+
+		word = (summaryWord << 6) + 63 - std::countl_zero(summaryBits);
+		return (word << 6) + 63 - std::countl_zero(words_[word]);
+	}
+};
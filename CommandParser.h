@@ -0,0 +1,174 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <format>
+
+#include "OrderCommand.h"
+
+// Note(vss): expected state of the book stated by a scenario's closing "R" line.
+struct ScenarioResult
+{
+	std::size_t allCount_{};
+	std::size_t bidCount_{};
+	std::size_t askCount_{};
+};
+
+/**
+* @brief Parser for the text format of OrderbookTests/TestFolder, one command per line:
+* "A <B|S> <OrderType> <price> <quantity> <orderId>", "M <orderId> <B|S> <price> <quantity>", "C <orderId>"
+* "P" to start a call auction, "U" to uncross it, and a closing "R <orders> <bid levels> <ask levels>" with the expected state of the book.
+* GoodTillDate adds carry a seventh column, their expiry in nanoseconds since the Unix epoch.
+* It works on string_views and never allocates, so it keeps up with files of millions of lines.
+* AppendCommand writes the same format back, so generated files read like the hand written scenarios.
+*/
+class CommandParser
+{
+public:
+
+	static bool TryParseCommand(std::string_view line, OrderCommand& command)
+	{
+		Columns columns;
+		const auto count = Split(line, columns);
+		if (count == 0 || columns[0].size() != 1)
+		{
+			return false;
+		}
+
+		switch (columns[0][0])
+		{
+		case 'A':
+			command.type_ = CommandType::Add;
+			command.expiry_ = 0;
+			if (count < 6 || !TryParseSide(columns[1], command.side_) || !TryParseOrderType(columns[2], command.orderType_) ||
+				!TryParseNumber(columns[3], command.price_) || !TryParseNumber(columns[4], command.quantity_) || !TryParseNumber(columns[5], command.orderId_))
+			{
+				return false;
+			}
+			return command.orderType_ == OrderType::GoodTillDate ? count == 7 && TryParseNumber(columns[6], command.expiry_) : count == 6;
+		case 'M':
+			command.type_ = CommandType::Modify;
+			command.orderType_ = OrderType::GoodTillCancel;
+			command.expiry_ = 0;
+			return count == 5 && TryParseNumber(columns[1], command.orderId_) && TryParseSide(columns[2], command.side_) &&
+				TryParseNumber(columns[3], command.price_) && TryParseNumber(columns[4], command.quantity_);
+		case 'C':
+			command = OrderCommand{ };
+			return count == 2 && TryParseNumber(columns[1], command.orderId_);
+		case 'P':
+			command = OrderCommand::BeginAuction();
+			return count == 1;
+		case 'U':
+			command = OrderCommand::Uncross();
+			return count == 1;
+		default:
+			return false;
+		}
+	}
+
+	static bool TryParseResult(std::string_view line, ScenarioResult& result)
+	{
+		Columns columns;
+		return Split(line, columns) == 4 && columns[0] == "R" && TryParseNumber(columns[1], result.allCount_) &&
+			TryParseNumber(columns[2], result.bidCount_) && TryParseNumber(columns[3], result.askCount_);
+	}
+
+	static void AppendCommand(std::string& buffer, const OrderCommand& command)
+	{
+		const auto side = command.side_ == Side::Buy ? 'B' : 'S';
+		switch (command.type_)
+		{
+		case CommandType::Add:
+			std::format_to(std::back_inserter(buffer), "A {} {} {} {} {}", side, OrderTypeNames[static_cast<std::size_t>(command.orderType_)], command.price_, command.quantity_, command.orderId_);
+			if (command.orderType_ == OrderType::GoodTillDate)
+			{
+				std::format_to(std::back_inserter(buffer), " {}", command.expiry_);
+			}
+			buffer.push_back('\n');
+			break;
+		case CommandType::Modify:
+			std::format_to(std::back_inserter(buffer), "M {} {} {} {}\n", command.orderId_, side, command.price_, command.quantity_);
+			break;
+		case CommandType::Cancel:
+			std::format_to(std::back_inserter(buffer), "C {}\n", command.orderId_);
+			break;
+		case CommandType::BeginAuction:
+			buffer.append("P\n");
+			break;
+		case CommandType::Uncross:
+			buffer.append("U\n");
+			break;
+		}
+	}
+
+private:
+
+	// Note(vss): indexed by OrderType.
+	static constexpr std::array<std::string_view, 6> OrderTypeNames{ "GoodTillCancel", "FillAndKill", "FillOrKill", "GoodForDay", "Market", "GoodTillDate" };
+
+	static constexpr std::size_t MaxColumns = 7;
+	using Columns = std::array<std::string_view, MaxColumns>;
+
+	// Note(vss): splits on runs of spaces, tabs and line endings, returns zero when the line has more columns than any command.
+	static std::size_t Split(std::string_view line, Columns& columns)
+	{
+		std::size_t count{};
+		std::size_t start{};
+
+		while (true)
+		{
+			start = line.find_first_not_of(" \t\r\n", start);
+			if (start == std::string_view::npos)
+			{
+				return count;
+			}
+			if (count == MaxColumns)
+			{
+				return 0;
+			}
+
+			const auto end = std::min(line.find_first_of(" \t\r\n", start), line.size());
+			columns[count++] = line.substr(start, end - start);
+			start = end;
+		}
+	}
+
+	template <typename Number>
+	static bool TryParseNumber(std::string_view column, Number& number)
+	{
+		const auto [end, error] = std::from_chars(column.data(), column.data() + column.size(), number);
+		return error == std::errc{} && end == column.data() + column.size();
+	}
+
+	static bool TryParseSide(std::string_view column, Side& side)
+	{
+		if (column == "B")
+		{
+			side = Side::Buy;
+		}
+		else if (column == "S")
+		{
+			side = Side::Sell;
+		}
+		else return false;
+
+		return true;
+	}
+
+	static bool TryParseOrderType(std::string_view column, OrderType& orderType)
+	{
+		const auto name = std::ranges::find(OrderTypeNames, column);
+		if (name == OrderTypeNames.end())
+		{
+			return false;
+		}
+
+		orderType = static_cast<OrderType>(name - OrderTypeNames.begin());
+		return true;
+	}
+};
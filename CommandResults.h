@@ -0,0 +1,91 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "Aliases.h"
+#include "Trade.h"
+
+// Note(vss): what a command did to the book.
+enum class CommandOutcome : std::uint8_t
+{
+	Rested,     // the order, or what was left of it after trading, rests in the book
+	Filled,     // the order traded in full
+	Killed,     // a FillAndKill order traded what it could, the rest was discarded
+	Rejected,   // the order never reached the book, e.g. a duplicate id or a FillOrKill that could not fill
+	Cancelled,
+	NotFound,   // a cancel or modify named an order that is not resting
+	SessionChanged, // a BeginAuction or Uncross moved the book to its other session state, one that does not is Rejected
+};
+
+/**
+* @brief Result of one command of a batch. Its trades are tradeCount_ consecutive entries of the batch's trades, starting at firstTrade_.
+*/
+struct CommandResult
+{
+	CommandOutcome outcome_{ };
+	Quantity filledQuantity_{ };
+	std::uint32_t firstTrade_{ };
+	std::uint32_t tradeCount_{ };
+};
+
+/**
+* @brief Output of Orderbook::ApplyCommands, one CommandResult per command plus every trade of the batch in execution order.
+* It is owned by the caller and meant to be reused, the book clears it at the start of each batch but keeps its capacity,
+* so a batch that fits the reserved space does not allocate.
+*/
+class CommandResults
+{
+public:
+
+	CommandResults() = default;
+
+	CommandResults(std::size_t commandCapacity, std::size_t tradeCapacity)
+	{
+		Reserve(commandCapacity, tradeCapacity);
+	}
+
+	void Reserve(std::size_t commandCapacity, std::size_t tradeCapacity)
+	{
+		results_.reserve(commandCapacity);
+		trades_.reserve(tradeCapacity);
+	}
+
+	void Clear()
+	{
+		results_.clear();
+		trades_.clear();
+	}
+
+	std::size_t Size() const { return results_.size(); }
+	const CommandResult& operator[](std::size_t index) const { return results_[index]; }
+
+	std::span<const CommandResult> GetResults() const { return results_; }
+	std::span<const Trade> GetTrades() const { return trades_; }
+	std::span<const Trade> GetTrades(const CommandResult& result) const
+	{
+		return std::span<const Trade>{ trades_ }.subspan(result.firstTrade_, result.tradeCount_);
+	}
+
+	// Note(vss): the book calls these while it applies a batch, AddResult claims every trade added since the previous result.
+	void AddTrade(const Trade& trade) { trades_.push_back(trade); }
+	void AddResult(CommandOutcome outcome)
+	{
+		const auto firstTrade = results_.empty() ? std::size_t{} : static_cast<std::size_t>(results_.back().firstTrade_) + results_.back().tradeCount_;
+
+		CommandResult result{ outcome, 0, static_cast<std::uint32_t>(firstTrade), static_cast<std::uint32_t>(trades_.size() - firstTrade) };
+		// Note(vss): every trade of a command involves the command's own order once, on either side, for an uncross this sums to its volume.
+		for (const auto& trade : GetTrades(result))
+		{
+			result.filledQuantity_ += trade.GetBidTrade().quantity_;
+		}
+		results_.push_back(result);
+	}
+
+private:
+
+	std::vector<CommandResult> results_;
+	Trades trades_;
+};
\ No newline at end of file
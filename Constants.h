@@ -7,4 +7,5 @@
 struct Constants
 {
 	static const Price InvalidPrice = std::numeric_limits<Price>::quiet_NaN();
+	static const OrderHandle InvalidHandle = std::numeric_limits<OrderHandle>::max();
 };
\ No newline at end of file
@@ -0,0 +1,400 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+#include <format>
+#include <unordered_map>
+
+#include "Orderbook.h"
+#include "OrderCommand.h"
+#include "MatchingEngine.h"
+#include "RingBuffer.h"
+#include "WaitStrategy.h"
+#include "Expiry.h"
+#include "ThreadAffinity.h"
+
+struct ExchangeSettings
+{
+	std::size_t workerCount_{ 1 };
+	// Note(vss): worker i is pinned to cores_[i], workers without an entry are left to the scheduler. Start throws if a pin is refused.
+	std::vector<std::size_t> cores_{};
+};
+
+struct SymbolCommand
+{
+	SymbolId symbol_{};
+	OrderCommand command_{};
+};
+
+struct ExchangeEvent
+{
+	SymbolId symbol_{};
+	EngineEvent event_{};
+};
+
+/**
+* @brief Hosts many Orderbooks and routes commands to them by SymbolId.
+* Symbols are spread round robin over a fixed pool of worker threads. Each worker owns its books outright and runs them
+* single writer, with its own inbound and outbound rings, so workers share nothing on the hot path.
+* A single DeadlineTimer serves every book instead of one expiry thread per book. Each worker hands it the earliest due time
+* across its books and is woken only once that has passed, so books with nothing due cost no wakeups at all.
+* Symbols are registered with AddSymbol before Start, the routing table is read only from then on.
+*/
+template <typename WaitStrategy = BusySpinWaitStrategy,
+	std::size_t CommandCapacity = 1 << 16,
+	std::size_t EventCapacity = 1 << 16>
+class Exchange
+{
+public:
+
+	explicit Exchange(ExchangeSettings settings) :
+		settings_{ std::move(settings) }
+	{
+		if (settings_.workerCount_ == 0)
+		{
+			throw std::logic_error("An exchange needs at least one worker.");
+		}
+
+		workers_.reserve(settings_.workerCount_);
+		for (std::size_t index = 0; index < settings_.workerCount_; ++index)
+		{
+			workers_.push_back(std::make_unique<Worker>());
+		}
+	}
+
+	Exchange(const Exchange&) = delete;
+	void operator=(const Exchange&) = delete;
+
+	Exchange(Exchange&&) = delete;
+	void operator=(Exchange&&) = delete;
+
+	~Exchange()
+	{
+		Stop();
+	}
+
+	void AddSymbol(SymbolId symbol, OrderbookSettings settings = { })
+	{
+		if (started_)
+		{
+			throw std::logic_error(std::format("Cannot add symbol ({}) to a running exchange.", symbol));
+		}
+		if (routes_.contains(symbol))
+		{
+			throw std::logic_error(std::format("Symbol ({}) is already listed.", symbol));
+		}
+
+		auto& worker = *workers_[routes_.size() % workers_.size()];
+		settings.threading_ = OrderbookThreading::SingleWriter;
+		worker.AddBook(symbol, settings);
+		routes_.emplace(symbol, &worker);
+	}
+
+	void Start()
+	{
+		if (started_)
+		{
+			return;
+		}
+		started_ = true;
+
+		// Note(vss): started ahead of the workers, which schedule it from their first command on.
+		expiryTimer_.emplace([this]
+			{
+				const auto now = GetCurrentTimestamp();
+				auto next = DeadlineTimer::NoDeadline;
+				for (auto& worker : workers_)
+				{
+					next = std::min(next, worker->TakeExpiry(now));
+				}
+				return next;
+			});
+
+		for (std::size_t index = 0; index < workers_.size(); ++index)
+		{
+			workers_[index]->Start(expiryTimer_.value(), index < settings_.cores_.size() ? std::optional{ settings_.cores_[index] } : std::nullopt);
+		}
+	}
+
+	// Note(vss): commands already accepted are processed before the workers exit, the timer is stopped once none of them can schedule it.
+	void Stop()
+	{
+		for (auto& worker : workers_)
+		{
+			worker->Stop();
+		}
+
+		expiryTimer_.reset();
+	}
+
+	bool TrySubmit(SymbolId symbol, const OrderCommand& command)
+	{
+		return Route(symbol).TrySubmit(SymbolCommand{ symbol, command });
+	}
+
+	void Submit(SymbolId symbol, const OrderCommand& command)
+	{
+		auto& worker = Route(symbol);
+		const SymbolCommand symbolCommand{ symbol, command };
+
+		while (!worker.TrySubmit(symbolCommand))
+		{
+			CpuRelax();
+		}
+	}
+
+	/**
+	* @brief Drains the outbound rings of all workers into function(const ExchangeEvent&) and returns the number of events.
+	* Only one thread may poll. Events of one symbol arrive in order, events of different symbols may interleave.
+	*/
+	template <typename Function>
+	std::size_t PollEvents(Function&& function)
+	{
+		std::size_t count{};
+		ExchangeEvent event;
+
+		for (auto& worker : workers_)
+		{
+			while (worker->TryPollEvent(event))
+			{
+				function(event);
+				++count;
+			}
+		}
+
+		return count;
+	}
+
+	std::size_t GetWorkerCount() const { return workers_.size(); }
+
+private:
+
+	class Worker
+	{
+	public:
+
+		void AddBook(SymbolId symbol, const OrderbookSettings& settings)
+		{
+			books_.try_emplace(symbol, Book{ std::make_unique<Orderbook>(settings) });
+		}
+
+		void Start(DeadlineTimer& expiryTimer, std::optional<std::size_t> core)
+		{
+			expiryTimer_ = &expiryTimer;
+			thread_ = std::jthread{ [this] { Run(); } };
+			if (core.has_value() && !PinThreadToCore(thread_, core.value()))
+			{
+				Stop();
+				throw std::logic_error(std::format("Cannot pin an exchange worker to core ({}).", core.value()));
+			}
+		}
+
+		void Stop()
+		{
+			if (!thread_.joinable())
+			{
+				return;
+			}
+
+			stop_.store(true, std::memory_order_release);
+			signal_.fetch_add(1, std::memory_order_release);
+			signal_.notify_all();
+			thread_.join();
+		}
+
+		bool TrySubmit(const SymbolCommand& command)
+		{
+			if (!commands_.TryPush(command))
+			{
+				return false;
+			}
+
+			waitStrategy_.Notify(signal_);
+			return true;
+		}
+
+		bool TryPollEvent(ExchangeEvent& event)
+		{
+			return events_.TryPop(event);
+		}
+
+		/**
+		* @brief Called on the timer thread. Once the worker's deadline has passed it is cleared and the worker is woken to expire its books,
+		* otherwise the deadline is returned for the timer to sleep until.
+		*/
+		Timestamp TakeExpiry(Timestamp now)
+		{
+			auto deadline = expiryDeadline_.load(std::memory_order_acquire);
+			while (deadline <= now)
+			{
+				if (expiryDeadline_.compare_exchange_weak(deadline, DeadlineTimer::NoDeadline, std::memory_order_acq_rel))
+				{
+					expiryDue_.store(true, std::memory_order_release);
+					signal_.fetch_add(1, std::memory_order_release);
+					signal_.notify_one();
+					return DeadlineTimer::NoDeadline;
+				}
+			}
+			return deadline;
+		}
+
+	private:
+
+		struct Book
+		{
+			std::unique_ptr<Orderbook> orderbook_;
+			std::uint64_t sequence_{};
+		};
+
+		std::unordered_map<SymbolId, Book> books_;
+		MpscRingBuffer<SymbolCommand, CommandCapacity> commands_;
+		SpscRingBuffer<ExchangeEvent, EventCapacity> events_;
+		WaitStrategy waitStrategy_;
+
+		alignas(CacheLineSize) std::atomic<std::uint64_t> signal_{};
+		std::atomic<bool> stop_{ false };
+		std::atomic<bool> expiryDue_{ false };
+		bool expiryPending_{ false };
+		// Note(vss): the earliest due time across the worker's books that the timer was given, lowered by the worker and cleared by the timer.
+		std::atomic<Timestamp> expiryDeadline_{ DeadlineTimer::NoDeadline };
+		DeadlineTimer* expiryTimer_{};
+
+		std::jthread thread_;
+
+		void Run()
+		{
+			while (true)
+			{
+				const auto observed = signal_.load(std::memory_order_acquire);
+				const bool stopping = stop_.load(std::memory_order_acquire);
+
+				bool worked = Drain();
+
+				// Note(vss): books with a full batch may have more due, they get another batch after the ring is drained again.
+				if (expiryDue_.exchange(false, std::memory_order_acq_rel) || expiryPending_)
+				{
+					worked = ExpireDueBooks() || worked;
+				}
+
+				if (worked)
+				{
+					continue;
+				}
+
+				for (auto& [_, book] : books_)
+				{
+					book.orderbook_->FlushJournal();
+				}
+
+				if (stopping)
+				{
+					return;
+				}
+
+				waitStrategy_.Wait(signal_, observed);
+			}
+		}
+
+		/**
+		* @brief Expires the books whose earliest expiry is due and schedules the timer for the earliest one left across all of them.
+		* Only runs once the timer has found the worker's deadline passed, books with nothing due are asked for their next due time and left alone.
+		*/
+		bool ExpireDueBooks()
+		{
+			const auto now = GetCurrentTimestamp();
+			auto next = DeadlineTimer::NoDeadline;
+			bool worked = false;
+			expiryPending_ = false;
+
+			for (auto& [_, book] : books_)
+			{
+				if (book.orderbook_->GetNextExpiry() <= now)
+				{
+					const auto expired = book.orderbook_->ExpireOrders(now);
+					expiryPending_ = expiryPending_ || expired == ExpiryBatchSize;
+					worked = worked || expired != 0;
+				}
+				next = std::min(next, book.orderbook_->GetNextExpiry());
+			}
+
+			if (!expiryPending_)
+			{
+				ScheduleExpiry(next);
+			}
+			return worked;
+		}
+
+		// Note(vss): the timer is woken only when a book's due time comes before the worker's deadline, most adds leave it where it was.
+		void ScheduleExpiry(Timestamp due)
+		{
+			auto deadline = expiryDeadline_.load(std::memory_order_acquire);
+			while (due < deadline)
+			{
+				if (expiryDeadline_.compare_exchange_weak(deadline, due, std::memory_order_acq_rel))
+				{
+					expiryTimer_->Schedule(due);
+					return;
+				}
+			}
+		}
+
+		bool Drain()
+		{
+			bool worked = false;
+			SymbolCommand command;
+
+			while (commands_.TryPop(command))
+			{
+				Process(command);
+				worked = true;
+			}
+
+			return worked;
+		}
+
+		void Process(const SymbolCommand& symbolCommand)
+		{
+			const auto& [symbol, command] = symbolCommand;
+			auto& book = books_.at(symbol);
+			const auto sequence = ++book.sequence_;
+
+			book.orderbook_->ApplyCommand(command, [&](const Trade& trade)
+				{
+					Publish(ExchangeEvent{ symbol, EngineEvent{ EngineEventType::Trade, sequence, command.type_, command.orderId_, trade.GetBidTrade(), trade.GetAskTrade() } });
+				});
+			ScheduleExpiry(book.orderbook_->GetNextExpiry());
+
+			Publish(ExchangeEvent{ symbol, EngineEvent{ EngineEventType::CommandProcessed, sequence, command.type_, command.orderId_ } });
+		}
+
+		void Publish(const ExchangeEvent& event)
+		{
+			while (!events_.TryPush(event))
+			{
+				CpuRelax();
+			}
+		}
+	};
+
+	ExchangeSettings settings_;
+	std::vector<std::unique_ptr<Worker>> workers_;
+	std::unordered_map<SymbolId, Worker*> routes_;
+	std::optional<DeadlineTimer> expiryTimer_;
+	bool started_{ false };
+
+	Worker& Route(SymbolId symbol)
+	{
+		const auto route = routes_.find(symbol);
+		if (route == routes_.end())
+		{
+			throw std::logic_error(std::format("Symbol ({}) is not listed.", symbol));
+		}
+
+		return *route->second;
+	}
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <ctime>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+#include "Aliases.h"
+
+// Note(vss): most orders Orderbook::ExpireOrders cancels per call, so a large expiry never holds the book for long.
+constexpr std::size_t ExpiryBatchSize = 256;
+
+inline Timestamp ToTimestamp(std::chrono::system_clock::time_point time)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+inline Timestamp GetCurrentTimestamp()
+{
+	return ToTimestamp(std::chrono::system_clock::now());
+}
+
+inline std::tm ToLocalTime(std::time_t time)
+{
+	std::tm parts{ };
+#ifdef _WIN32
+	localtime_s(&parts, &time);
+#else
+	localtime_r(&time, &parts);
+#endif
+	return parts;
+}
+
+/**
+* @brief Returns the next point in time at which GoodForDay orders expire, which is 16:00 local time
+* today, or tomorrow if that has already passed.
+*/
+inline std::chrono::system_clock::time_point GetNextGoodForDayCutoff(std::chrono::system_clock::time_point now)
+{
+	using namespace std;
+	const auto end = chrono::hours(16);
+
+	auto now_parts = ToLocalTime(chrono::system_clock::to_time_t(now));
+
+	if (now_parts.tm_hour >= end.count())
+	{
+		now_parts.tm_mday += 1;
+	}
+
+	now_parts.tm_hour = end.count();
+	now_parts.tm_min = 0;
+	now_parts.tm_sec = 0;
+	now_parts.tm_isdst = -1;
+
+	return chrono::system_clock::from_time_t(mktime(&now_parts));
+}
+
+/**
+* @brief Owns one timer thread that sleeps until the deadline it was last given, in nanoseconds since the Unix epoch, and then calls onDue.
+* onDue returns the next deadline, NoDeadline if there is none, and Schedule brings the deadline forward from any other thread.
+* A book that has nothing due therefore costs no wakeups and no locking at all.
+*/
+class DeadlineTimer
+{
+public:
+
+	static constexpr Timestamp NoDeadline = std::numeric_limits<Timestamp>::max();
+
+	explicit DeadlineTimer(std::function<Timestamp()> onDue) :
+		onDue_{ std::move(onDue) },
+		thread_{ [this](std::stop_token stopToken) { Run(stopToken); } }
+	{}
+
+	DeadlineTimer(const DeadlineTimer&) = delete;
+	void operator=(const DeadlineTimer&) = delete;
+
+	~DeadlineTimer()
+	{
+		thread_.request_stop();
+		thread_.join();
+	}
+
+	// Note(vss): a deadline later than the current one is ignored, onDue reports the real next deadline whenever the thread wakes.
+	void Schedule(Timestamp deadline)
+	{
+		{
+			std::lock_guard lock{ mutex_ };
+			if (deadline >= deadline_)
+			{
+				return;
+			}
+			deadline_ = deadline;
+		}
+		conditionVariable_.notify_one();
+	}
+
+private:
+
+	std::function<Timestamp()> onDue_;
+	std::mutex mutex_;
+	std::condition_variable_any conditionVariable_;
+	Timestamp deadline_{ NoDeadline };
+	std::jthread thread_;
+
+	void Run(std::stop_token stopToken)
+	{
+		std::unique_lock lock{ mutex_ };
+		while (!stopToken.stop_requested())
+		{
+			const auto deadline = deadline_;
+			if (deadline == NoDeadline)
+			{
+				conditionVariable_.wait(lock, stopToken, [this] { return deadline_ != NoDeadline; });
+				continue;
+			}
+			if (GetCurrentTimestamp() < deadline)
+			{
+				const auto due = std::chrono::system_clock::time_point{ std::chrono::ceil<std::chrono::system_clock::duration>(std::chrono::nanoseconds{ deadline }) };
+				conditionVariable_.wait_until(lock, stopToken, due, [this, deadline] { return deadline_ < deadline; });
+				continue;
+			}
+
+			// Note(vss): onDue runs unlocked, so it may take the book's lock while other threads call Schedule holding it.
+			deadline_ = NoDeadline;
+			lock.unlock();
+			const auto next = onDue_();
+			lock.lock();
+			deadline_ = std::min(deadline_, next);
+		}
+	}
+};
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <limits>
+#include <memory_resource>
+
+#include "Aliases.h"
+#include "Constants.h"
+#include "OrderbookMemoryUsage.h"
+
+/**
+* @brief Resting orders that expire, grouped into buckets of BucketWidth nanoseconds by their expiry.
+* Each bucket is an intrusive list threaded through a side array indexed by OrderHandle, so adding and removing an order is O(1)
+* and the bucket map only changes when a bucket is created or drained. Every GoodForDay order shares the bucket of the day's cutoff.
+* A bucket becomes due once its whole span has passed, so an order leaves the book no earlier than its expiry and at most
+* BucketWidth later.
+*/
+class ExpiryIndex
+{
+public:
+
+	static constexpr Timestamp BucketWidth = 1'000'000;
+
+	explicit ExpiryIndex(std::pmr::memory_resource* resource) :
+		buckets_{ resource }
+	{}
+
+	void Reserve(std::size_t capacity) { links_.reserve(capacity); }
+
+	void Add(OrderHandle handle, Timestamp expiry)
+	{
+		if (handle >= links_.size())
+		{
+			links_.resize(static_cast<std::size_t>(handle) + 1);
+		}
+
+		const auto bucket = ToBucket(expiry);
+		auto& head = buckets_.try_emplace(bucket, OrderHandle{ Constants::InvalidHandle }).first->second;
+
+		links_[handle] = Link{ Constants::InvalidHandle, head, bucket };
+		if (head != Constants::InvalidHandle)
+		{
+			links_[head].prev_ = handle;
+		}
+		head = handle;
+	}
+
+	void Remove(OrderHandle handle)
+	{
+		const auto& link = links_[handle];
+
+		if (link.prev_ != Constants::InvalidHandle)
+		{
+			links_[link.prev_].next_ = link.next_;
+		}
+		else if (link.next_ != Constants::InvalidHandle)
+		{
+			buckets_.find(link.bucket_)->second = link.next_;
+		}
+		else
+		{
+			buckets_.erase(link.bucket_);
+		}
+
+		if (link.next_ != Constants::InvalidHandle)
+		{
+			links_[link.next_].prev_ = link.prev_;
+		}
+	}
+
+	// Note(vss): an order from the earliest bucket whose span ended by now, InvalidHandle if nothing is due. It stays indexed until Remove.
+	OrderHandle GetDue(Timestamp now) const
+	{
+		if (buckets_.empty())
+		{
+			return Constants::InvalidHandle;
+		}
+
+		const auto& [bucket, head] = *buckets_.begin();
+		if ((bucket + 1) * BucketWidth > now)
+		{
+			return Constants::InvalidHandle;
+		}
+		return head;
+	}
+
+	// Note(vss): when the earliest bucket becomes due, the time an owner has to come back for it.
+	Timestamp GetNextDue() const
+	{
+		return buckets_.empty() ? std::numeric_limits<Timestamp>::max() : (buckets_.begin()->first + 1) * BucketWidth;
+	}
+
+	static Timestamp GetDueTime(Timestamp expiry) { return (ToBucket(expiry) + 1) * BucketWidth; }
+
+	bool Empty() const { return buckets_.empty(); }
+	std::size_t MemoryUsage() const
+	{
+		return links_.capacity() * sizeof(Link) + buckets_.size() * (sizeof(decltype(buckets_)::value_type) + MapNodeOverhead);
+	}
+
+private:
+
+	struct Link
+	{
+		OrderHandle prev_{ Constants::InvalidHandle };
+		OrderHandle next_{ Constants::InvalidHandle };
+		Timestamp bucket_{};
+	};
+
+	std::pmr::map<Timestamp, OrderHandle> buckets_;
+	std::vector<Link> links_;
+
+	static Timestamp ToBucket(Timestamp expiry) { return expiry / BucketWidth; }
+};
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <algorithm>
+#include <type_traits>
+#include <format>
+
+#include "LatencyHistogram.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+* Define ORDERBOOK_INSTRUMENTATION for every translation unit that includes Orderbook.h to time each phase of a command
+* and count the work it did. Without it the book's probe is an empty type whose calls compile to nothing.
+*/
+#if defined(ORDERBOOK_INSTRUMENTATION)
+constexpr bool InstrumentationEnabled = true;
+#else
+constexpr bool InstrumentationEnabled = false;
+#endif
+
+// Note(vss): the TSC where there is one, a fixed frequency tick counter on ARM, steady_clock nanoseconds otherwise.
+inline std::uint64_t ReadCycleCounter()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#elif defined(__aarch64__)
+	std::uint64_t value;
+	asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+	return value;
+#else
+	return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Note(vss): public calls into the book, each one is timed as a whole.
+enum class ProbeOperation
+{
+	Add,
+	Modify,
+	Cancel,
+	Batch,
+	Expire,
+	Session,
+};
+
+constexpr std::array<const char*, 6> ProbeOperationNames{ "Add", "Modify", "Cancel", "Batch", "Expire", "Session" };
+
+// Note(vss): where the time inside a call goes, LockWait is spent before the call holds the book.
+enum class ProbePhase
+{
+	LockWait,
+	Journal,
+	Match,
+	Book,
+	Publish,
+};
+
+constexpr std::array<const char*, 5> ProbePhaseNames{ "LockWait", "Journal", "Match", "Book", "Publish" };
+
+// Note(vss): work done per call. LevelsTouched counts every level a call walked or changed, OrdersMatched the resting orders it filled completely.
+enum class ProbeCounter
+{
+	LevelsTouched,
+	OrdersMatched,
+	Trades,
+};
+
+constexpr std::array<const char*, 3> ProbeCounterNames{ "LevelsTouched", "OrdersMatched", "Trades" };
+
+struct InstrumentationHistograms
+{
+	std::array<LatencyHistogram, ProbeOperationNames.size()> operations_;
+	std::array<LatencyHistogram, ProbePhaseNames.size()> phases_;
+	std::array<LatencyHistogram, ProbeCounterNames.size()> counters_;
+
+	void Merge(const InstrumentationHistograms& other)
+	{
+		for (std::size_t index = 0; index < operations_.size(); ++index)
+		{
+			operations_[index].Merge(other.operations_[index]);
+		}
+		for (std::size_t index = 0; index < phases_.size(); ++index)
+		{
+			phases_[index].Merge(other.phases_[index]);
+		}
+		for (std::size_t index = 0; index < counters_.size(); ++index)
+		{
+			counters_[index].Merge(other.counters_[index]);
+		}
+	}
+
+	void Reset()
+	{
+		std::ranges::for_each(operations_, &LatencyHistogram::Reset);
+		std::ranges::for_each(phases_, &LatencyHistogram::Reset);
+		std::ranges::for_each(counters_, &LatencyHistogram::Reset);
+	}
+};
+
+/**
+* @brief Owns the histograms of every thread that ran an instrumented call. Each thread records into its own set,
+* guarded by a lock only that thread and a collecting reader ever take, so recording threads never contend with each other.
+* A thread's histograms are folded into the retired totals when the thread exits. A set is a few hundred KB, so every set lives on the heap.
+*/
+class Instrumentation
+{
+public:
+
+	static Instrumentation& Get()
+	{
+		static Instrumentation instrumentation;
+		return instrumentation;
+	}
+
+	// Note(vss): called once per instrumented call with everything the call gathered, so the thread's lock is taken once per call.
+	template <typename Function>
+	void Record(Function&& function)
+	{
+		thread_local ThreadHistograms histograms{ *this };
+
+		std::scoped_lock lock{ histograms.mutex_ };
+		function(*histograms.histograms_);
+	}
+
+	std::unique_ptr<InstrumentationHistograms> Collect() const
+	{
+		std::scoped_lock lock{ mutex_ };
+
+		auto histograms = std::make_unique<InstrumentationHistograms>(*retired_);
+		for (const auto* thread : threads_)
+		{
+			std::scoped_lock threadLock{ thread->mutex_ };
+			histograms->Merge(*thread->histograms_);
+		}
+		return histograms;
+	}
+
+	void Reset()
+	{
+		std::scoped_lock lock{ mutex_ };
+
+		retired_->Reset();
+		for (auto* thread : threads_)
+		{
+			std::scoped_lock threadLock{ thread->mutex_ };
+			thread->histograms_->Reset();
+		}
+	}
+
+	// Note(vss): counter ticks per nanosecond, measured over the lifetime of the process so far.
+	double GetTicksPerNanosecond() const
+	{
+		const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime_).count();
+		return nanoseconds <= 0 ? 1.0 : static_cast<double>(ReadCycleCounter() - startTicks_) / static_cast<double>(nanoseconds);
+	}
+
+	/**
+	* @brief Writes one row per operation, phase and counter. Times are in counter ticks, the header gives the measured tick rate.
+	*/
+	void Write(std::ostream& output) const
+	{
+		const auto collected = Collect();
+		const auto& histograms = *collected;
+
+		output << std::format("instrumentation {}, {:.3f} ticks/ns\n", InstrumentationEnabled ? "on" : "off", GetTicksPerNanosecond());
+		output << std::format("{:<16}{:>12}{:>10}{:>10}{:>10}{:>10}{:>12}\n", "probe", "count", "mean", "p50", "p99", "p99.9", "max");
+
+		for (std::size_t index = 0; index < ProbeOperationNames.size(); ++index)
+		{
+			WriteRow(output, ProbeOperationNames[index], histograms.operations_[index]);
+		}
+		for (std::size_t index = 0; index < ProbePhaseNames.size(); ++index)
+		{
+			WriteRow(output, ProbePhaseNames[index], histograms.phases_[index]);
+		}
+		for (std::size_t index = 0; index < ProbeCounterNames.size(); ++index)
+		{
+			WriteRow(output, ProbeCounterNames[index], histograms.counters_[index]);
+		}
+	}
+
+	void Write(const std::string& path) const
+	{
+		std::ofstream file{ path };
+		if (!file)
+		{
+			throw std::logic_error(std::format("Cannot open ({}) for the instrumentation report.", path));
+		}
+		Write(file);
+	}
+
+private:
+
+	struct ThreadHistograms
+	{
+		explicit ThreadHistograms(Instrumentation& owner) :
+			owner_{ owner }
+		{
+			std::scoped_lock lock{ owner_.mutex_ };
+			owner_.threads_.push_back(this);
+		}
+
+		~ThreadHistograms()
+		{
+			std::scoped_lock lock{ owner_.mutex_ };
+			owner_.retired_->Merge(*histograms_);
+			std::erase(owner_.threads_, this);
+		}
+
+		Instrumentation& owner_;
+		mutable std::mutex mutex_;
+		std::unique_ptr<InstrumentationHistograms> histograms_{ std::make_unique<InstrumentationHistograms>() };
+	};
+
+	mutable std::mutex mutex_;
+	std::vector<ThreadHistograms*> threads_;
+	std::unique_ptr<InstrumentationHistograms> retired_{ std::make_unique<InstrumentationHistograms>() };
+	std::uint64_t startTicks_{ ReadCycleCounter() };
+	std::chrono::steady_clock::time_point startTime_{ std::chrono::steady_clock::now() };
+
+	static void WriteRow(std::ostream& output, const char* name, const LatencyHistogram& histogram)
+	{
+		if (histogram.GetCount() == 0)
+		{
+			return;
+		}
+		output << std::format("{:<16}{:>12}{:>10.0f}{:>10}{:>10}{:>10}{:>12}\n", name, histogram.GetCount(), histogram.GetMean(),
+			histogram.GetPercentile(50.0), histogram.GetPercentile(99.0), histogram.GetPercentile(99.9), histogram.GetMax());
+	}
+};
+
+/**
+* @brief Gathers one call: Begin is given the counter value from before the lock was requested, every Mark charges the time
+* since the previous mark to a phase, and End records the call, its phases and its counters into the calling thread's histograms.
+*/
+class ActiveProbe
+{
+public:
+
+	std::uint64_t Now() const { return ReadCycleCounter(); }
+
+	void Begin(ProbeOperation operation, std::uint64_t requested)
+	{
+		operation_ = operation;
+		start_ = requested;
+		last_ = Now();
+		phases_ = { };
+		counters_ = { };
+		phases_[static_cast<std::size_t>(ProbePhase::LockWait)] = last_ - start_;
+	}
+
+	void Mark(ProbePhase phase)
+	{
+		const auto now = Now();
+		phases_[static_cast<std::size_t>(phase)] += now - last_;
+		last_ = now;
+	}
+
+	void Count(ProbeCounter counter, std::uint64_t count = 1) { counters_[static_cast<std::size_t>(counter)] += count; }
+
+	void End()
+	{
+		const auto elapsed = Now() - start_;
+		Instrumentation::Get().Record([&](InstrumentationHistograms& histograms)
+			{
+				histograms.operations_[static_cast<std::size_t>(operation_)].Record(elapsed);
+				for (std::size_t index = 0; index < phases_.size(); ++index)
+				{
+					histograms.phases_[index].Record(phases_[index]);
+				}
+				for (std::size_t index = 0; index < counters_.size(); ++index)
+				{
+					histograms.counters_[index].Record(counters_[index]);
+				}
+			});
+	}
+
+private:
+
+	ProbeOperation operation_{ };
+	std::uint64_t start_{};
+	std::uint64_t last_{};
+	std::array<std::uint64_t, ProbePhaseNames.size()> phases_{ };
+	std::array<std::uint64_t, ProbeCounterNames.size()> counters_{ };
+};
+
+// Note(vss): stands in for ActiveProbe when instrumentation is compiled out, every call is an empty inline function.
+class NullProbe
+{
+public:
+
+	std::uint64_t Now() const { return 0; }
+	void Begin(ProbeOperation, std::uint64_t) {}
+	void Mark(ProbePhase) {}
+	void Count(ProbeCounter, std::uint64_t = 1) {}
+	void End() {}
+};
+
+using CallProbe = std::conditional_t<InstrumentationEnabled, ActiveProbe, NullProbe>;
\ No newline at end of file
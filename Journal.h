@@ -0,0 +1,228 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <format>
+
+#include "OrderCommand.h"
+#include "OrderbookSettings.h"
+#include "PlatformFile.h"
+
+/**
+* @brief On disk form of one OrderCommand. Fixed size and little endian, so the journal is a header followed by a plain array of records.
+* The checksum lets replay tell a record that was only partly written before a crash from a complete one.
+*/
+struct JournalRecord
+{
+	std::uint64_t sequence_{};
+	OrderId orderId_{};
+	Timestamp expiry_{};
+	std::int32_t price_{};
+	std::uint32_t quantity_{};
+	std::uint8_t commandType_{};
+	std::uint8_t orderType_{};
+	std::uint8_t side_{};
+	std::uint8_t reserved_{};
+	std::uint32_t checksum_{};
+
+	static JournalRecord FromCommand(std::uint64_t sequence, const OrderCommand& command)
+	{
+		JournalRecord record{ sequence, command.orderId_, command.expiry_, command.price_, command.quantity_,
+			static_cast<std::uint8_t>(command.type_), static_cast<std::uint8_t>(command.orderType_), static_cast<std::uint8_t>(command.side_) };
+		record.checksum_ = record.ComputeChecksum();
+		return record;
+	}
+
+	OrderCommand ToCommand() const
+	{
+		return OrderCommand{ static_cast<CommandType>(commandType_), static_cast<OrderType>(orderType_), orderId_, static_cast<Side>(side_),
+			static_cast<Price>(price_), static_cast<Quantity>(quantity_), expiry_ };
+	}
+
+	// Note(vss): FNV-1a over every byte in front of the checksum.
+	std::uint32_t ComputeChecksum() const
+	{
+		std::byte bytes[offsetof(JournalRecord, checksum_)];
+		std::memcpy(bytes, this, sizeof(bytes));
+
+		std::uint32_t hash{ 2166136261u };
+		for (const auto byte : bytes)
+		{
+			hash = (hash ^ static_cast<std::uint32_t>(byte)) * 16777619u;
+		}
+		return hash;
+	}
+};
+
+static_assert(sizeof(JournalRecord) == 40, "JournalRecord is an on disk format, its layout must not change.");
+
+struct JournalHeader
+{
+	static constexpr std::uint32_t Magic = 0x4a424f4c; // Note(vss): "LOBJ".
+	// Note(vss): version 2 added the expiry of GoodTillDate orders to every record.
+	static constexpr std::uint32_t Version = 2;
+
+	std::uint32_t magic_{ Magic };
+	std::uint32_t version_{ Version };
+	std::uint32_t recordSize_{ sizeof(JournalRecord) };
+	std::uint32_t reserved_[5]{ };
+};
+
+static_assert(sizeof(JournalHeader) == 32, "JournalHeader is an on disk format, its layout must not change.");
+
+/**
+* @brief Maps a journal and walks its records in order. Reading stops at the first record that is incomplete,
+* fails its checksum or breaks the sequence, which is where the process went down while appending.
+*/
+class JournalReader
+{
+public:
+
+	explicit JournalReader(const std::string& path) :
+		file_{ path }
+	{
+		const auto data = file_.GetData();
+		if (data.empty())
+		{
+			return;
+		}
+
+		JournalHeader header;
+		if (data.size() < sizeof(header))
+		{
+			throw std::logic_error(std::format("Journal ({}) is missing its header.", path));
+		}
+
+		std::memcpy(&header, data.data(), sizeof(header));
+		if (header.magic_ != JournalHeader::Magic || header.version_ != JournalHeader::Version || header.recordSize_ != sizeof(JournalRecord))
+		{
+			throw std::logic_error(std::format("({}) is not a version {} journal.", path, JournalHeader::Version));
+		}
+
+		headerSize_ = sizeof(header);
+		records_ = data.subspan(sizeof(header));
+	}
+
+	/**
+	* @brief Calls function(const OrderCommand&) for every intact record past afterSequence and returns how many there were.
+	* Sequences start at one and have no gaps, so the walk jumps straight to the first record it needs.
+	*/
+	template <typename Function>
+	std::uint64_t ForEachCommand(Function&& function, std::uint64_t afterSequence = 0) const
+	{
+		auto sequence = afterSequence;
+		JournalRecord record;
+
+		for (auto offset = afterSequence * sizeof(record); offset + sizeof(record) <= records_.size(); offset += sizeof(record))
+		{
+			std::memcpy(&record, records_.data() + offset, sizeof(record));
+			if (record.sequence_ != sequence + 1 || record.checksum_ != record.ComputeChecksum())
+			{
+				break;
+			}
+
+			function(record.ToCommand());
+			++sequence;
+		}
+
+		return sequence - afterSequence;
+	}
+
+	// Note(vss): size of the header plus every intact record, anything past it is debris from a crash.
+	std::uint64_t ValidSize() const
+	{
+		return headerSize_ + ForEachCommand([](const OrderCommand&) {}) * sizeof(JournalRecord);
+	}
+
+private:
+
+	MappedFile file_;
+	std::uint64_t headerSize_{};
+	std::span<const std::byte> records_;
+};
+
+/**
+* @brief Appends OrderCommands to a journal file. Every record is written to the file as it is appended, so it is in the OS's hands
+* before its command is applied, only syncing it to the disk is batched as JournalSettings asks.
+* Opening an existing journal drops any torn tail and continues its sequence, so a recovered book keeps appending to the same file.
+*/
+class JournalWriter
+{
+public:
+
+	explicit JournalWriter(const JournalSettings& settings) :
+		syncPolicy_{ settings.syncPolicy_ },
+		batchSize_{ settings.batchSize_ == 0 ? 1 : settings.batchSize_ },
+		file_{ settings.path_ }
+	{
+		if (file_.Size() == 0)
+		{
+			const JournalHeader header;
+			file_.Write(std::as_bytes(std::span{ &header, 1 }));
+			file_.Sync();
+			return;
+		}
+
+		// Note(vss): the reader's mapping is released before truncating, Windows refuses to shorten a file that is still mapped.
+		const auto validSize = JournalReader{ settings.path_ }.ValidSize();
+		if (validSize != file_.Size())
+		{
+			file_.Truncate(validSize);
+		}
+		sequence_ = (validSize - sizeof(JournalHeader)) / sizeof(JournalRecord);
+	}
+
+	JournalWriter(const JournalWriter&) = delete;
+	void operator=(const JournalWriter&) = delete;
+
+	~JournalWriter()
+	{
+		try
+		{
+			Flush();
+		}
+		catch (...)
+		{
+		}
+	}
+
+	void Append(const OrderCommand& command)
+	{
+		const auto record = JournalRecord::FromCommand(++sequence_, command);
+		file_.Write(std::as_bytes(std::span{ &record, 1 }));
+
+		if (++unsynced_ >= batchSize_ || syncPolicy_ == JournalSyncPolicy::EveryCommand)
+		{
+			Flush();
+		}
+	}
+
+	// Note(vss): syncs the records written since the last sync, unless the policy leaves that to the OS.
+	void Flush()
+	{
+		if (unsynced_ == 0)
+		{
+			return;
+		}
+
+		unsynced_ = 0;
+		if (syncPolicy_ != JournalSyncPolicy::None)
+		{
+			file_.Sync();
+		}
+	}
+
+	std::uint64_t GetSequence() const { return sequence_; }
+
+private:
+
+	JournalSyncPolicy syncPolicy_;
+	std::size_t batchSize_;
+	AppendFile file_;
+	std::size_t unsynced_{};
+	std::uint64_t sequence_{};
+};
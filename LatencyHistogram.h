@@ -0,0 +1,99 @@
+#pragma once
+
+#include <bit>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+/**
+* @brief Fixed size log linear histogram of latencies, in the spirit of HdrHistogram.
+* A value is bucketed by its highest set bit and then split into SubBucketCount linear sub buckets, so every
+* percentile is exact to within 1/SubBucketCount of the value while Record stays a handful of instructions and never allocates.
+*/
+class LatencyHistogram
+{
+public:
+
+	void Record(std::uint64_t value)
+	{
+		++counts_[ToIndex(value)];
+		++count_;
+		sum_ += value;
+		max_ = std::max(max_, value);
+	}
+
+	void Merge(const LatencyHistogram& other)
+	{
+		for (std::size_t index = 0; index < BucketCount; ++index)
+		{
+			counts_[index] += other.counts_[index];
+		}
+		count_ += other.count_;
+		sum_ += other.sum_;
+		max_ = std::max(max_, other.max_);
+	}
+
+	void Reset() { *this = LatencyHistogram{ }; }
+
+	std::uint64_t GetCount() const { return count_; }
+	std::uint64_t GetMax() const { return max_; }
+	double GetMean() const { return count_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_); }
+
+	// Note(vss): percentile is in [0, 100], the result is the highest value that falls in the same bucket as the percentile.
+	std::uint64_t GetPercentile(double percentile) const
+	{
+		if (count_ == 0)
+		{
+			return 0;
+		}
+
+		const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(percentile / 100.0 * static_cast<double>(count_) + 0.5));
+		std::uint64_t seen{};
+		for (std::size_t index = 0; index < BucketCount; ++index)
+		{
+			seen += counts_[index];
+			if (seen >= rank)
+			{
+				return std::min(ToHighestValue(index), max_);
+			}
+		}
+
+		return max_;
+	}
+
+private:
+
+	static constexpr std::size_t SubBucketBits = 6;
+	static constexpr std::size_t SubBucketCount = std::size_t{ 1 } << SubBucketBits;
+	static constexpr std::size_t BucketCount = (64 - SubBucketBits + 1) * SubBucketCount;
+
+	std::array<std::uint64_t, BucketCount> counts_{ };
+	std::uint64_t count_{};
+	std::uint64_t sum_{};
+	std::uint64_t max_{};
+
+	static std::size_t ToIndex(std::uint64_t value)
+	{
+		if (value < SubBucketCount)
+		{
+			return static_cast<std::size_t>(value);
+		}
+
+		const auto shift = static_cast<std::size_t>(std::bit_width(value)) - 1 - SubBucketBits;
+		return (shift + 1) * SubBucketCount + static_cast<std::size_t>((value >> shift) - SubBucketCount);
+	}
+
+	static std::uint64_t ToHighestValue(std::size_t index)
+	{
+		const auto group = index / SubBucketCount;
+		const auto subBucket = index % SubBucketCount;
+		if (group == 0)
+		{
+			return subBucket;
+		}
+
+		const auto shift = group - 1;
+		return ((static_cast<std::uint64_t>(SubBucketCount + subBucket + 1)) << shift) - 1;
+	}
+};
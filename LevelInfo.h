@@ -1,13 +1,23 @@
 #pragma once
 
+#include <vector>
+#include <cstddef>
+
 #include "Aliases.h"
 
 // Note(vss): struct with Price and Quantity.
 struct LevelInfo
 {
 	Price price_;
-	Quantity quantity_;
+	LevelQuantity quantity_;
 };
 
 // Note(vss): defines a vector of LevelInfo struct, each storing price and quantity information.
-using LevelInfos = std::vector<LevelInfo>;
\ No newline at end of file
+using LevelInfos = std::vector<LevelInfo>;
+
+// Note(vss): number of levels GetDepth wrote into the caller's bid and ask buffers.
+struct DepthCount
+{
+	std::size_t bids_{};
+	std::size_t asks_{};
+};
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "Aliases.h"
+
+// Note(vss): AVX2 where the build enables it (/arch:AVX2, -mavx2), SSE2 on any other x64 build, a plain loop everywhere else.
+#if defined(__AVX2__) && (defined(_M_X64) || defined(__x86_64__))
+#include <immintrin.h>
+#define ORDERBOOK_LEVEL_SCAN_AVX2
+#elif defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+#define ORDERBOOK_LEVEL_SCAN_SSE2
+#endif
+
+#if defined(ORDERBOOK_LEVEL_SCAN_AVX2) || defined(ORDERBOOK_LEVEL_SCAN_SSE2)
+// Note(vss): adds the two 64 bit lanes of sum.
+inline std::uint64_t AddLanes(__m128i sum)
+{
+	return static_cast<std::uint64_t>(_mm_cvtsi128_si64(sum)) + static_cast<std::uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(sum, sum)));
+}
+#endif
+
+/**
+* @brief Index of the first of count quantities at which a running total, starting at total, reaches target, count if it never does.
+* total is left holding the running total up to and including that quantity. Blocks that stay short of target are summed
+* eight quantities at a time with AVX2, four with SSE2, widened to 64 bits so no block can overflow, and only the block
+* that reaches target is walked one quantity at a time.
+*/
+inline std::size_t FindCumulative(const LevelQuantity* quantities, std::size_t count, std::uint64_t target, std::uint64_t& total)
+{
+	static_assert(sizeof(LevelQuantity) == sizeof(std::uint32_t), "The kernels load level quantities as 32 bit lanes.");
+
+	std::size_t index{};
+#if defined(ORDERBOOK_LEVEL_SCAN_AVX2)
+	for (; index + 8 <= count; index += 8)
+	{
+		const auto low = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(quantities + index)));
+		const auto high = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(quantities + index + 4)));
+		const auto sum = _mm256_add_epi64(low, high);
+		const auto block = AddLanes(_mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1)));
+		if (total + block >= target)
+		{
+			break;
+		}
+		total += block;
+	}
+#elif defined(ORDERBOOK_LEVEL_SCAN_SSE2)
+	const auto zero = _mm_setzero_si128();
+	for (; index + 4 <= count; index += 4)
+	{
+		const auto values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(quantities + index));
+		const auto block = AddLanes(_mm_add_epi64(_mm_unpacklo_epi32(values, zero), _mm_unpackhi_epi32(values, zero)));
+		if (total + block >= target)
+		{
+			break;
+		}
+		total += block;
+	}
+#endif
+
+	for (; index < count; ++index)
+	{
+		total += quantities[index];
+		if (total >= target)
+		{
+			return index;
+		}
+	}
+	return count;
+}
+
+/**
+* @brief Writes the indices of the first non zero quantities among count into offsets, at most capacity of them, and returns how many.
+* Blocks are compared against zero eight quantities at a time with AVX2, four with SSE2, and only the non zero lanes of a block
+* are visited, so a run of empty levels costs one comparison per block.
+*/
+inline std::size_t FindNonZero(const LevelQuantity* quantities, std::size_t count, std::uint32_t* offsets, std::size_t capacity)
+{
+	std::size_t found{};
+	std::size_t index{};
+
+	auto AddOffsets = [&](unsigned mask)
+		{
+			for (; mask != 0 && found < capacity; mask &= mask - 1)
+			{
+				offsets[found++] = static_cast<std::uint32_t>(index + std::countr_zero(mask));
+			}
+		};
+
+#if defined(ORDERBOOK_LEVEL_SCAN_AVX2)
+	const auto zero = _mm256_setzero_si256();
+	for (; index + 8 <= count && found < capacity; index += 8)
+	{
+		const auto empty = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(quantities + index)), zero);
+		AddOffsets(~static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(empty))) & 0xFF);
+	}
+#elif defined(ORDERBOOK_LEVEL_SCAN_SSE2)
+	const auto zero = _mm_setzero_si128();
+	for (; index + 4 <= count && found < capacity; index += 4)
+	{
+		const auto empty = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(quantities + index)), zero);
+		AddOffsets(~static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(empty))) & 0xF);
+	}
+#endif
+
+	for (; index < count && found < capacity; ++index)
+	{
+		if (quantities[index] != 0)
+		{
+			offsets[found++] = static_cast<std::uint32_t>(index);
+		}
+	}
+	return found;
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <span>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include "Side.h"
+#include "Aliases.h"
+#include "LevelInfo.h"
+
+/**
+* @brief New state of one price level. A count_ of zero means the level is gone.
+*/
+struct LevelUpdate
+{
+	Side side_;
+	Price price_;
+	LevelQuantity quantity_;
+	LevelQuantity count_;
+};
+
+/**
+* @brief Every level changed by one inbound command, each level once with its final state, in the order they were first touched.
+* Sequence numbers increase by one per batch, so a gap means the consumer missed a batch and should resync from a snapshot.
+*/
+struct MarketDataBatch
+{
+	std::uint64_t sequence_;
+	std::span<const LevelUpdate> updates_;
+};
+
+/**
+* @brief Full state of the book's levels as of batch sequence_, bids best first followed by asks best first.
+* Applying every batch after sequence_ to it yields the live book.
+*/
+struct MarketDataSnapshot
+{
+	std::uint64_t sequence_{};
+	std::vector<LevelUpdate> levels_{};
+};
+
+using MarketDataListener = std::function<void(const MarketDataBatch&)>;
+
+
+/**
+* @brief Best levels of both sides as of the end of the last command, the best bid and offer being bids_[0] and asks_[0].
+* Only the first bidCount_ and askCount_ entries are meaningful.
+*/
+struct TopOfBook
+{
+	static constexpr std::size_t Depth = 10;
+
+	std::uint32_t bidCount_{};
+	std::uint32_t askCount_{};
+	std::array<LevelInfo, Depth> bids_{ };
+	std::array<LevelInfo, Depth> asks_{ };
+};
\ No newline at end of file
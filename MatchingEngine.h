@@ -0,0 +1,210 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "Orderbook.h"
+#include "OrderCommand.h"
+#include "RingBuffer.h"
+#include "WaitStrategy.h"
+#include "Expiry.h"
+
+enum class EngineEventType
+{
+	Trade,
+	CommandProcessed,
+};
+
+/**
+* @brief Outbound event of a MatchingEngine. Every command yields zero or more Trade events followed by one
+* CommandProcessed event, all stamped with the sequence number the matching thread gave that command.
+*/
+struct EngineEvent
+{
+	EngineEventType type_{ EngineEventType::CommandProcessed };
+	std::uint64_t sequence_{};
+	CommandType commandType_{ CommandType::Cancel };
+	OrderId orderId_{};
+	TradeInfo bidTrade_{};
+	TradeInfo askTrade_{};
+};
+
+/**
+* @brief Runs one Orderbook on a dedicated matching thread that is the only writer of the book, so the book takes no locks.
+* Producers hand over OrderCommands through CommandRing, use an MpscRingBuffer when several gateway threads submit
+* and an SpscRingBuffer when there is exactly one. Results go out through a single consumer event ring.
+* WaitStrategy decides what the matching thread does when it runs dry, see WaitStrategy.h.
+*/
+template <typename CommandRing = MpscRingBuffer<OrderCommand, 1 << 16>,
+	typename WaitStrategy = BusySpinWaitStrategy,
+	std::size_t EventCapacity = 1 << 16>
+class MatchingEngine
+{
+public:
+
+	explicit MatchingEngine(OrderbookSettings settings = { }) :
+		orderbook_{ ToSingleWriter(settings) },
+		expiryTimer_{ [this] { return RequestExpiry(); } },
+		matchingThread_{ [this] { Run(); } }
+	{}
+
+	MatchingEngine(const MatchingEngine&) = delete;
+	void operator=(const MatchingEngine&) = delete;
+
+	MatchingEngine(MatchingEngine&&) = delete;
+	void operator=(MatchingEngine&&) = delete;
+
+	// Note(vss): commands already accepted are still processed before the matching thread exits, the timer outlives it.
+	~MatchingEngine()
+	{
+		stop_.store(true, std::memory_order_release);
+		signal_.fetch_add(1, std::memory_order_release);
+		signal_.notify_all();
+		matchingThread_.join();
+	}
+
+	bool TrySubmit(const OrderCommand& command)
+	{
+		if (!commands_.TryPush(command))
+		{
+			return false;
+		}
+
+		waitStrategy_.Notify(signal_);
+		return true;
+	}
+
+	void Submit(const OrderCommand& command)
+	{
+		while (!TrySubmit(command))
+		{
+			CpuRelax();
+		}
+	}
+
+	// Note(vss): only one thread may poll events.
+	bool TryPollEvent(EngineEvent& event)
+	{
+		return events_.TryPop(event);
+	}
+
+private:
+
+	Orderbook orderbook_;
+	CommandRing commands_;
+	SpscRingBuffer<EngineEvent, EventCapacity> events_;
+	WaitStrategy waitStrategy_;
+	std::uint64_t sequence_{};
+
+	alignas(CacheLineSize) std::atomic<std::uint64_t> signal_{};
+	std::atomic<bool> stop_{ false };
+	std::atomic<bool> expiryDue_{ false };
+	bool expiryPending_{ false };
+	// Note(vss): the due time the matching thread last gave the timer, only the matching thread reads or writes it.
+	Timestamp scheduledExpiry_{ DeadlineTimer::NoDeadline };
+
+	// Note(vss): declared before the matching thread, which schedules it from its first command on.
+	DeadlineTimer expiryTimer_;
+	std::jthread matchingThread_;
+
+	static OrderbookSettings ToSingleWriter(OrderbookSettings settings)
+	{
+		settings.threading_ = OrderbookThreading::SingleWriter;
+		return settings;
+	}
+
+	void Run()
+	{
+		while (true)
+		{
+			const auto observed = signal_.load(std::memory_order_acquire);
+			const bool stopping = stop_.load(std::memory_order_acquire);
+
+			bool worked = Drain();
+
+			// Note(vss): a full batch means more may be due, the next pass expires another batch after draining the ring again.
+			if (expiryDue_.exchange(false, std::memory_order_acq_rel) || expiryPending_)
+			{
+				scheduledExpiry_ = DeadlineTimer::NoDeadline;
+				const auto expired = orderbook_.ExpireOrders(GetCurrentTimestamp());
+				expiryPending_ = expired == ExpiryBatchSize;
+				worked = worked || expired != 0;
+				if (!expiryPending_)
+				{
+					ScheduleExpiry();
+				}
+			}
+
+			if (worked)
+			{
+				continue;
+			}
+
+			// Note(vss): the rings ran dry, so the journal batch is closed here rather than left waiting for more commands.
+			orderbook_.FlushJournal();
+
+			if (stopping)
+			{
+				return;
+			}
+
+			waitStrategy_.Wait(signal_, observed);
+		}
+	}
+
+	bool Drain()
+	{
+		bool worked = false;
+		OrderCommand command;
+
+		while (commands_.TryPop(command))
+		{
+			Process(command);
+			worked = true;
+		}
+
+		return worked;
+	}
+
+	void Process(const OrderCommand& command)
+	{
+		const auto sequence = ++sequence_;
+
+		orderbook_.ApplyCommand(command, [&](const Trade& trade)
+			{
+				Publish(EngineEvent{ EngineEventType::Trade, sequence, command.type_, command.orderId_, trade.GetBidTrade(), trade.GetAskTrade() });
+			});
+		ScheduleExpiry();
+
+		Publish(EngineEvent{ EngineEventType::CommandProcessed, sequence, command.type_, command.orderId_ });
+	}
+
+	// Note(vss): back pressure, the matching thread stalls rather than dropping results when the event ring is full.
+	void Publish(const EngineEvent& event)
+	{
+		while (!events_.TryPush(event))
+		{
+			CpuRelax();
+		}
+	}
+
+	// Note(vss): the timer is woken only when an order brings the book's next due time forward, most adds leave it where it was.
+	void ScheduleExpiry()
+	{
+		const auto due = orderbook_.GetNextExpiry();
+		if (due < scheduledExpiry_)
+		{
+			scheduledExpiry_ = due;
+			expiryTimer_.Schedule(due);
+		}
+	}
+
+	// Note(vss): the book is single writer, so the timer only raises a flag and lets the matching thread do the cancels and schedule the next deadline.
+	Timestamp RequestExpiry()
+	{
+		expiryDue_.store(true, std::memory_order_release);
+		signal_.fetch_add(1, std::memory_order_release);
+		signal_.notify_one();
+		return DeadlineTimer::NoDeadline;
+	}
+};
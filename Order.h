@@ -1,6 +1,6 @@
 #pragma once
 
-#include <list>
+#include <memory>
 #include <exception>
 #include <format>
 
@@ -18,13 +18,14 @@ class Order
 {
 public:
 
-	Order(OrderType orderType, OrderId orderId, Side side, Price price, Quantity quantity) :
+	Order(OrderType orderType, OrderId orderId, Side side, Price price, Quantity quantity, Timestamp expiry = 0) :
 		orderType_{ orderType },
 		orderId_{ orderId },
 		side_{ side },
 		price_{ price },
 		initialQuantity_{ quantity },
-		remainingQuantity_{ quantity }
+		remainingQuantity_{ quantity },
+		expiry_{ expiry }
 	{}
 
 	Order(OrderId orderId, Side side, Quantity quantity) :
@@ -38,6 +39,9 @@ public:
 	Quantity GetInitialQuantity() const { return initialQuantity_; }
 	Quantity GetRemainingQuantity() const { return remainingQuantity_; }
 	Quantity GetFilledQuantity() const { return GetInitialQuantity() - GetRemainingQuantity(); }
+	// Note(vss): when a GoodTillDate or GoodForDay order leaves the book, zero for orders that never expire.
+	Timestamp GetExpiry() const { return expiry_; }
+	bool HasExpiry() const { return orderType_ == OrderType::GoodForDay || orderType_ == OrderType::GoodTillDate; }
 	bool IsFilled() const { return GetRemainingQuantity() == 0; }
 	void Fill(Quantity quantity)
 	{
@@ -65,9 +69,8 @@ private:
 	Price price_;
 	Quantity initialQuantity_;
 	Quantity remainingQuantity_;
+	Timestamp expiry_;
 };
 
-// Note(vss): can be stored in a orders dictionary and a bid/ask dictionary
-using OrderPointer = std::shared_ptr<Order>;
-// TODO(vss): try std::vector
-using OrderPointers = std::list<OrderPointer>;
\ No newline at end of file
+// Note(vss): kept for callers that build orders on the heap, the book itself copies them into its OrderPool.
+using OrderPointer = std::shared_ptr<Order>;
\ No newline at end of file
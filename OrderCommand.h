@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Order.h"
+#include "OrderModify.h"
+
+enum class CommandType
+{
+	Add,
+	Modify,
+	Cancel,
+	BeginAuction, // session commands, they name no order
+	Uncross,
+};
+
+/**
+* @brief A flat, trivially copyable description of one inbound request against a book.
+* Used wherever requests have to be queued or stored rather than applied straight away.
+*/
+struct OrderCommand
+{
+	CommandType type_{ CommandType::Cancel };
+	OrderType orderType_{ OrderType::GoodTillCancel };
+	OrderId orderId_{};
+	Side side_{ Side::Buy };
+	Price price_{};
+	Quantity quantity_{};
+	Timestamp expiry_{};
+
+	static OrderCommand Add(const Order& order)
+	{
+		return OrderCommand{ CommandType::Add, order.GetOrderType(), order.GetOrderId(), order.GetSide(), order.GetPrice(), order.GetInitialQuantity(), order.GetExpiry() };
+	}
+
+	static OrderCommand Modify(const OrderModify& order)
+	{
+		return OrderCommand{ CommandType::Modify, OrderType::GoodTillCancel, order.GetOrderId(), order.GetSide(), order.GetPrice(), order.GetQuantity() };
+	}
+
+	static OrderCommand Cancel(OrderId orderId)
+	{
+		return OrderCommand{ CommandType::Cancel, OrderType::GoodTillCancel, orderId };
+	}
+
+	static OrderCommand BeginAuction()
+	{
+		return OrderCommand{ CommandType::BeginAuction };
+	}
+
+	static OrderCommand Uncross()
+	{
+		return OrderCommand{ CommandType::Uncross };
+	}
+
+	Order ToOrder() const { return Order{ orderType_, orderId_, side_, price_, quantity_, expiry_ }; }
+	OrderModify ToOrderModify() const { return OrderModify{ orderId_, side_, price_, quantity_ }; }
+};
@@ -0,0 +1,316 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "OrderCommand.h"
+
+/**
+* @brief Shape of a synthetic order flow. Weights are relative, they do not have to add up to one.
+*/
+struct OrderFlowSettings
+{
+	std::uint64_t seed_{ 1 };
+
+	double addWeight_{ 0.55 };
+	double modifyWeight_{ 0.10 };
+	double cancelWeight_{ 0.35 };
+
+	// Note(vss): indexed by OrderType, GoodTillCancel, FillAndKill, FillOrKill, GoodForDay, Market, GoodTillDate.
+	std::array<double, 6> orderTypeWeights_{ 0.75, 0.07, 0.03, 0.08, 0.02, 0.05 };
+
+	// Note(vss): GoodTillDate orders expire on average meanLifetime_ seconds after they arrive, counted from expiryEpoch_ rather than the clock
+	// so a seed always gives the same file. The default epoch, 2100-01-01, keeps them resting in a replay until they trade or are cancelled,
+	// so the expiry index is maintained on every rest, fill and cancel of one.
+	Timestamp expiryEpoch_{ 4'102'444'800'000'000'000 };
+	double meanLifetime_{ 60.0 };
+
+	Price referencePrice_{ 10'000 };
+	// Note(vss): distance from the touch in ticks is geometric with this mean, aggressive orders price through the touch by the same distance.
+	double meanTicksFromTouch_{ 4.0 };
+	double aggressiveProbability_{ 0.08 };
+	// Note(vss): chance per command that the touch moves one tick up or down.
+	double touchMoveProbability_{ 0.01 };
+
+	// Note(vss): quantities are log normal around the median and rounded up to whole lots.
+	Quantity medianQuantity_{ 100 };
+	double quantitySigma_{ 0.8 };
+	Quantity lotSize_{ 1 };
+	Quantity maxQuantity_{ static_cast<Quantity>(std::min<std::uint32_t>(100'000, std::numeric_limits<Quantity>::max())) };
+
+	// Note(vss): arrivals switch between a calm and a burst Poisson rate, bursts last meanBurstLength_ commands on average.
+	double calmRate_{ 50'000.0 };
+	double burstRate_{ 2'000'000.0 };
+	double burstProbability_{ 0.0005 };
+	double meanBurstLength_{ 2'000.0 };
+
+	// Note(vss): resting orders sent back to back before the regular flow starts, both sides straddling the reference price like an opening auction.
+	std::size_t openingBurst_{ 0 };
+};
+
+struct GeneratedCommand
+{
+	OrderCommand command_;
+	// Note(vss): arrival time in nanoseconds since the start of the stream.
+	std::uint64_t timestamp_{};
+};
+
+/**
+* @brief Produces a seeded, reproducible stream of OrderCommands. It keeps track of the orders it left resting, so cancels and
+* modifies name orders that exist, and of a touch that drifts over time, so prices cluster around it the way real flow does.
+* It does not run a book, so some cancels will name orders a real book has already filled, which production flow does too.
+* Every draw is computed here from the output of mt19937_64, which the standard fixes bit for bit, instead of going through the
+* <random> distributions, whose algorithms differ between standard libraries. The only library calls left are std::log, std::exp and
+* std::cos, so the same seed gives the same file on MSVC and libstdc++ unless their rounding of those differs.
+*/
+class OrderFlowGenerator
+{
+public:
+
+	explicit OrderFlowGenerator(const OrderFlowSettings& settings) :
+		settings_{ settings },
+		random_{ settings.seed_ },
+		// Note(vss): weights in CommandType order, so a drawn index is the command type.
+		commandWeights_{ settings.addWeight_, settings.modifyWeight_, settings.cancelWeight_ },
+		ticksFromTouch_{ 1.0 / (1.0 + settings.meanTicksFromTouch_) },
+		logMedianQuantity_{ std::log(static_cast<double>(std::max<Quantity>(settings.medianQuantity_, 1))) },
+		bid_{ static_cast<Price>(settings.referencePrice_ - 1) },
+		ask_{ static_cast<Price>(settings.referencePrice_ + 1) }
+	{
+		if (settings.lotSize_ == 0 || settings.maxQuantity_ < settings.lotSize_ || settings.calmRate_ <= 0.0 || settings.burstRate_ <= 0.0 ||
+			settings.meanLifetime_ <= 0.0)
+		{
+			throw std::logic_error("Invalid order flow settings.");
+		}
+	}
+
+	GeneratedCommand Next()
+	{
+		const auto timestamp = NextTimestamp();
+
+		if (openingLeft_ != 0)
+		{
+			--openingLeft_;
+			return { NextOpeningAdd(), timestamp };
+		}
+
+		MoveTouch();
+
+		// Note(vss): with nothing resting there is nothing to cancel or modify, so the flow starts with adds.
+		const auto type = live_.empty() ? CommandType::Add : static_cast<CommandType>(NextWeighted(commandWeights_));
+		switch (type)
+		{
+		case CommandType::Cancel:
+			return { NextCancel(), timestamp };
+		case CommandType::Modify:
+			return { NextModify(), timestamp };
+		default:
+			return { NextAdd(), timestamp };
+		}
+	}
+
+	std::size_t GetLiveCount() const { return live_.size(); }
+
+private:
+
+	struct LiveOrder
+	{
+		OrderId orderId_;
+		Side side_;
+	};
+
+	OrderFlowSettings settings_;
+	std::mt19937_64 random_;
+	std::array<double, 3> commandWeights_;
+	// Note(vss): success probability of the geometric distance from the touch, and the mean of the quantity's logarithm.
+	double ticksFromTouch_;
+	double logMedianQuantity_;
+
+	std::vector<LiveOrder> live_;
+	std::unordered_map<OrderId, std::size_t> liveIndex_;
+	OrderId lastOrderId_{};
+
+	Price bid_;
+	Price ask_;
+	std::size_t openingLeft_{ settings_.openingBurst_ };
+	bool inBurst_{ false };
+	double clock_{};
+
+	// Note(vss): uniform in [0, 1), from the top 53 bits of one draw.
+	double NextUnit() { return static_cast<double>(random_() >> 11) * (1.0 / 9007199254740992.0); }
+
+	// Note(vss): uniform in [0, count), draws past the last whole multiple of count are redrawn so no index is favoured.
+	std::size_t NextIndex(std::size_t count)
+	{
+		const auto limit = std::numeric_limits<std::uint64_t>::max() - std::numeric_limits<std::uint64_t>::max() % count;
+		auto value = random_();
+		while (value >= limit)
+		{
+			value = random_();
+		}
+		return static_cast<std::size_t>(value % count);
+	}
+
+	// Note(vss): an index drawn with probability proportional to its weight, zero if every weight is zero.
+	template <std::size_t Count>
+	std::size_t NextWeighted(const std::array<double, Count>& weights)
+	{
+		double total{};
+		for (const auto weight : weights)
+		{
+			total += weight;
+		}
+
+		auto target = NextUnit() * total;
+		std::size_t chosen{};
+		for (std::size_t index = 0; index < Count; ++index)
+		{
+			if (weights[index] <= 0.0)
+			{
+				continue;
+			}
+			chosen = index;
+			if ((target -= weights[index]) < 0.0)
+			{
+				break;
+			}
+		}
+		return chosen;
+	}
+
+	double NextExponential(double rate) { return -std::log(1.0 - NextUnit()) / rate; }
+
+	// Note(vss): failures before the first success, by inverting the geometric distribution's cumulative probability.
+	Price NextGeometric(double probability)
+	{
+		return static_cast<Price>(std::floor(std::log(1.0 - NextUnit()) / std::log(1.0 - probability)));
+	}
+
+	// Note(vss): Box-Muller for the normal draw underneath.
+	double NextLogNormal(double mean, double sigma)
+	{
+		const auto radius = std::sqrt(-2.0 * std::log(1.0 - NextUnit()));
+		return std::exp(mean + sigma * radius * std::cos(6.283185307179586 * NextUnit()));
+	}
+
+	std::uint64_t NextTimestamp()
+	{
+		if (inBurst_)
+		{
+			inBurst_ = NextUnit() >= 1.0 / settings_.meanBurstLength_;
+		}
+		else
+		{
+			inBurst_ = NextUnit() < settings_.burstProbability_;
+		}
+
+		const auto rate = openingLeft_ != 0 || inBurst_ ? settings_.burstRate_ : settings_.calmRate_;
+		clock_ += NextExponential(rate) * 1e9;
+		return static_cast<std::uint64_t>(clock_);
+	}
+
+	void MoveTouch()
+	{
+		if (NextUnit() >= settings_.touchMoveProbability_)
+		{
+			return;
+		}
+
+		const Price step = NextUnit() < 0.5 ? -1 : 1;
+		if (bid_ + step > 1)
+		{
+			bid_ += step;
+			ask_ += step;
+		}
+	}
+
+	Side NextSide() { return NextUnit() < 0.5 ? Side::Buy : Side::Sell; }
+
+	Quantity NextQuantity()
+	{
+		const auto lots = std::ceil(NextLogNormal(logMedianQuantity_, settings_.quantitySigma_) / static_cast<double>(settings_.lotSize_));
+		const auto quantity = static_cast<Quantity>(std::clamp(lots * settings_.lotSize_, static_cast<double>(settings_.lotSize_), static_cast<double>(settings_.maxQuantity_)));
+		return quantity - quantity % settings_.lotSize_;
+	}
+
+	Price PassivePrice(Side side)
+	{
+		const auto distance = NextGeometric(ticksFromTouch_);
+		return side == Side::Buy ? std::max<Price>(1, bid_ - distance) : ask_ + distance;
+	}
+
+	Price AggressivePrice(Side side)
+	{
+		const auto distance = NextGeometric(ticksFromTouch_);
+		return side == Side::Buy ? ask_ + distance : std::max<Price>(1, bid_ - distance);
+	}
+
+	OrderCommand NextOpeningAdd()
+	{
+		const auto side = NextSide();
+		// Note(vss): opening orders straddle the reference price, so buys and sells overlap the way they do before an uncross.
+		const auto distance = NextGeometric(ticksFromTouch_);
+		const auto price = side == Side::Buy ? settings_.referencePrice_ + distance - static_cast<Price>(settings_.meanTicksFromTouch_)
+			: settings_.referencePrice_ - distance + static_cast<Price>(settings_.meanTicksFromTouch_);
+		return Rest(Order{ OrderType::GoodTillCancel, ++lastOrderId_, side, std::max<Price>(1, price), NextQuantity() });
+	}
+
+	OrderCommand NextAdd()
+	{
+		const auto side = NextSide();
+		const auto orderType = static_cast<OrderType>(NextWeighted(settings_.orderTypeWeights_));
+		const auto orderId = ++lastOrderId_;
+
+		if (orderType == OrderType::Market)
+		{
+			return OrderCommand::Add(Order{ orderId, side, NextQuantity() });
+		}
+
+		// Note(vss): FillAndKill and FillOrKill only make sense against the touch, the rest rest unless they are drawn aggressive.
+		const bool aggressive = orderType == OrderType::FillAndKill || orderType == OrderType::FillOrKill || NextUnit() < settings_.aggressiveProbability_;
+		const auto expiry = orderType == OrderType::GoodTillDate ?
+			settings_.expiryEpoch_ + static_cast<Timestamp>(clock_ + NextExponential(1.0 / settings_.meanLifetime_) * 1e9) + 1 : Timestamp{};
+		const Order order{ orderType, orderId, side, aggressive ? AggressivePrice(side) : PassivePrice(side), NextQuantity(), expiry };
+
+		return aggressive ? OrderCommand::Add(order) : Rest(order);
+	}
+
+	OrderCommand NextCancel()
+	{
+		const auto index = NextIndex(live_.size());
+		const auto orderId = live_[index].orderId_;
+		Forget(index);
+		return OrderCommand::Cancel(orderId);
+	}
+
+	OrderCommand NextModify()
+	{
+		const auto& order = live_[NextIndex(live_.size())];
+		return OrderCommand::Modify(OrderModify{ order.orderId_, order.side_, PassivePrice(order.side_), NextQuantity() });
+	}
+
+	OrderCommand Rest(const Order& order)
+	{
+		liveIndex_.emplace(order.GetOrderId(), live_.size());
+		live_.push_back(LiveOrder{ order.GetOrderId(), order.GetSide() });
+		return OrderCommand::Add(order);
+	}
+
+	void Forget(std::size_t index)
+	{
+		liveIndex_.erase(live_[index].orderId_);
+		if (index != live_.size() - 1)
+		{
+			live_[index] = live_.back();
+			liveIndex_[live_[index].orderId_] = index;
+		}
+		live_.pop_back();
+	}
+};
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <bit>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+#include "Aliases.h"
+#include "Constants.h"
+
+/**
+* @brief Maps the id of every resting order to its OrderHandle.
+* Ids live in one flat open addressing table with Robin Hood linear probing: a slot holds the id, the handle and how far the id sits
+* from its home slot, so a lookup stops at the first slot that is closer to home than it would be, and an erase shifts the following
+* run back by one instead of leaving a tombstone. Nothing is allocated per order, and the table only grows past the size it was reserved for.
+* An optional dense window maps ids in [firstId, firstId + count) straight to an array slot, for exchange assigned sequential ids.
+* Ids outside the window still go through the table.
+*/
+class OrderIdIndex
+{
+public:
+
+	OrderIdIndex()
+	{
+		Rehash(MinCapacity);
+	}
+
+	void Reserve(std::size_t count)
+	{
+		const auto capacity = std::bit_ceil(std::max(MinCapacity, count + count / 7 + 1));
+		if (capacity > slots_.size())
+		{
+			Rehash(capacity);
+		}
+	}
+
+	// Note(vss): count handles are allocated up front, one lookup in the window is a single array read.
+	void SetDenseWindow(OrderId firstId, std::size_t count)
+	{
+		denseFirst_ = firstId;
+		dense_.assign(count, OrderHandle{ Constants::InvalidHandle });
+	}
+
+	std::size_t Size() const { return size_; }
+	bool Empty() const { return size_ == 0; }
+	std::size_t MemoryUsage() const { return slots_.capacity() * sizeof(Slot) + dense_.capacity() * sizeof(OrderHandle); }
+	static constexpr std::size_t SlotSize() { return sizeof(Slot); }
+	bool Contains(OrderId orderId) const { return Find(orderId) != Constants::InvalidHandle; }
+
+	// Note(vss): InvalidHandle if the id is not indexed.
+	OrderHandle Find(OrderId orderId) const
+	{
+		if (const auto offset = orderId - denseFirst_; offset < dense_.size())
+		{
+			return dense_[offset];
+		}
+
+		for (std::uint32_t distance = 1, index = Home(orderId);; ++distance, index = (index + 1) & mask_)
+		{
+			const auto& slot = slots_[index];
+			if (slot.distance_ < distance)
+			{
+				return Constants::InvalidHandle;
+			}
+			if (slot.orderId_ == orderId)
+			{
+				return slot.handle_;
+			}
+		}
+	}
+
+	// Note(vss): false, and nothing changes, if the id is already indexed.
+	bool Insert(OrderId orderId, OrderHandle handle)
+	{
+		if (const auto offset = orderId - denseFirst_; offset < dense_.size())
+		{
+			if (dense_[offset] != Constants::InvalidHandle)
+			{
+				return false;
+			}
+			dense_[offset] = handle;
+			++size_;
+			return true;
+		}
+
+		if ((tableSize_ + 1) * 8 > slots_.size() * 7)
+		{
+			Rehash(slots_.size() * 2);
+		}
+
+		// Note(vss): an id already in the table sits before the first slot that would be taken from a richer entry, so it is found before anything moves.
+		Slot incoming{ orderId, handle, 1 };
+		for (auto index = Home(orderId);; index = (index + 1) & mask_)
+		{
+			auto& slot = slots_[index];
+			if (slot.distance_ == 0)
+			{
+				slot = incoming;
+				++tableSize_;
+				++size_;
+				return true;
+			}
+			if (slot.orderId_ == incoming.orderId_)
+			{
+				return false;
+			}
+			if (slot.distance_ < incoming.distance_)
+			{
+				std::swap(slot, incoming);
+			}
+			++incoming.distance_;
+		}
+	}
+
+	// Note(vss): removes the id and returns the handle it mapped to, InvalidHandle if the id was not indexed. Lookup and removal are one probe.
+	OrderHandle Erase(OrderId orderId)
+	{
+		if (const auto offset = orderId - denseFirst_; offset < dense_.size())
+		{
+			const auto handle = dense_[offset];
+			if (handle != Constants::InvalidHandle)
+			{
+				dense_[offset] = Constants::InvalidHandle;
+				--size_;
+			}
+			return handle;
+		}
+
+		auto index = Home(orderId);
+		for (std::uint32_t distance = 1;; ++distance, index = (index + 1) & mask_)
+		{
+			const auto& slot = slots_[index];
+			if (slot.distance_ < distance)
+			{
+				return Constants::InvalidHandle;
+			}
+			if (slot.orderId_ == orderId)
+			{
+				break;
+			}
+		}
+
+		const auto handle = slots_[index].handle_;
+		for (auto next = (index + 1) & mask_; slots_[next].distance_ > 1; index = next, next = (next + 1) & mask_)
+		{
+			slots_[index] = slots_[next];
+			--slots_[index].distance_;
+		}
+		slots_[index] = Slot{ };
+
+		--tableSize_;
+		--size_;
+		return handle;
+	}
+
+private:
+
+	static constexpr std::size_t MinCapacity = 16;
+
+	struct Slot
+	{
+		OrderId orderId_{};
+		OrderHandle handle_{ Constants::InvalidHandle };
+		// Note(vss): one more than the distance from the home slot, zero marks an empty slot.
+		std::uint32_t distance_{};
+	};
+
+	std::vector<Slot> slots_;
+	std::uint32_t mask_{};
+	int shift_{};
+	std::size_t tableSize_{};
+	std::size_t size_{};
+
+	std::vector<OrderHandle> dense_;
+	OrderId denseFirst_{};
+
+	// Note(vss): Fibonacci hashing, sequential ids spread over the whole table instead of filling one run.
+	std::uint32_t Home(OrderId orderId) const
+	{
+		return static_cast<std::uint32_t>((orderId * 0x9E3779B97F4A7C15ull) >> shift_);
+	}
+
+	void Rehash(std::size_t capacity)
+	{
+		auto slots = std::move(slots_);
+		slots_.assign(capacity, Slot{ });
+		mask_ = static_cast<std::uint32_t>(capacity - 1);
+		shift_ = 64 - std::countr_zero(capacity);
+
+		size_ -= tableSize_;
+		tableSize_ = 0;
+		for (const auto& slot : slots)
+		{
+			if (slot.distance_ != 0)
+			{
+				Insert(slot.orderId_, slot.handle_);
+			}
+		}
+	}
+};
\ No newline at end of file
@@ -18,6 +18,11 @@ public:
 	Price GetPrice() const { return price_; }
 	Quantity GetQuantity() const { return quantity_; }
 
+	Order ToOrder(OrderType type, Timestamp expiry = 0) const
+	{
+		return Order{ type, GetOrderId(), GetSide(), GetPrice(), GetQuantity(), expiry };
+	}
+
 	OrderPointer ToOrderPointer(OrderType type) const
 	{
 		return std::make_shared<Order>(type, GetOrderId(), GetSide(), GetPrice(), GetQuantity());
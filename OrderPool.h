@@ -0,0 +1,148 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <stdexcept>
+#include <format>
+
+#include "Order.h"
+#include "Aliases.h"
+#include "Constants.h"
+#include "OrderQueue.h"
+
+/**
+* @brief Everything the book keeps about a resting order except its open quantity, which sits next to its handle in the level's OrderQueue.
+* Matching only comes here for the id of each trade and when an order leaves the book, the rest is read by cancels, amends and snapshots.
+*/
+struct RestingOrder
+{
+	RestingOrder() = default;
+
+	explicit RestingOrder(const Order& order) :
+		orderId_{ order.GetOrderId() },
+		expiry_{ order.GetExpiry() },
+		price_{ order.GetPrice() },
+		initialQuantity_{ order.GetInitialQuantity() },
+		orderType_{ order.GetOrderType() },
+		side_{ order.GetSide() }
+	{}
+
+	OrderId orderId_{};
+	Timestamp expiry_{};
+	Price price_{ Constants::InvalidPrice };
+	Quantity initialQuantity_{};
+	// Note(vss): kept by the OrderPool, position in the level's queue while the order rests, next handle of the free list once it is released.
+	std::uint32_t link_{ Constants::InvalidHandle };
+	OrderType orderType_{ OrderType::GoodTillCancel };
+	Side side_{ Side::Buy };
+
+	bool HasExpiry() const { return orderType_ == OrderType::GoodForDay || orderType_ == OrderType::GoodTillDate; }
+};
+
+static_assert(sizeof(RestingOrder) == 32, "A resting order should stay two to a cache line.");
+
+/**
+* @brief Slab backed storage for resting orders, addressed by a stable OrderHandle.
+* Nodes are allocated in fixed size chunks that never move, so handles and references stay valid
+* until the order is released. Released nodes go on a free list and are reused before the pool grows,
+* which means a pool reserved up front does no heap allocation on add, cancel or fill.
+*/
+class OrderPool
+{
+public:
+
+	explicit OrderPool(std::size_t capacity = 0)
+	{
+		Reserve(capacity);
+	}
+
+	OrderPool(const OrderPool&) = delete;
+	void operator=(const OrderPool&) = delete;
+
+	void Reserve(std::size_t capacity)
+	{
+		while (Capacity() < capacity)
+		{
+			Grow();
+		}
+	}
+
+	// Note(vss): the order's remaining quantity is not stored here, PushBack puts it into the queue entry.
+	OrderHandle Allocate(const Order& order)
+	{
+		if (freeHead_ == Constants::InvalidHandle)
+		{
+			Grow();
+		}
+
+		const auto handle = freeHead_;
+		auto& node = Get(handle);
+		freeHead_ = node.link_;
+
+		node = RestingOrder{ order };
+		++size_;
+
+		return handle;
+	}
+
+	void Release(OrderHandle handle)
+	{
+		Get(handle).link_ = freeHead_;
+		freeHead_ = handle;
+		--size_;
+	}
+
+	RestingOrder& Get(OrderHandle handle) { return chunks_[handle >> ChunkShift][handle & ChunkMask]; }
+	const RestingOrder& Get(OrderHandle handle) const { return chunks_[handle >> ChunkShift][handle & ChunkMask]; }
+	// Note(vss): the pool remembers where in its queue each order sits, so GetEntry and Erase find its slot without searching the level.
+	void PushBack(OrderQueue& queue, OrderHandle handle, Quantity quantity)
+	{
+		Get(handle).link_ = queue.PushBack(handle, quantity);
+	}
+
+	OrderQueue::Entry& GetEntry(OrderQueue& queue, OrderHandle handle) { return queue.At(Get(handle).link_); }
+
+	void Erase(OrderQueue& queue, OrderHandle handle)
+	{
+		queue.Erase(Get(handle).link_);
+		if (queue.IsSparse())
+		{
+			queue.Compact([this](OrderHandle moved, std::uint32_t position) { Get(moved).link_ = position; });
+		}
+	}
+
+	void PopFront(OrderQueue& queue) { queue.PopFront(); }
+
+	std::size_t Size() const { return size_; }
+	std::size_t Capacity() const { return chunks_.size() * ChunkSize; }
+	std::size_t MemoryUsage() const { return Capacity() * sizeof(RestingOrder) + chunks_.capacity() * sizeof(chunks_[0]); }
+
+private:
+
+	static constexpr std::size_t ChunkShift = 12;
+	static constexpr std::size_t ChunkSize = std::size_t{ 1 } << ChunkShift;
+	static constexpr std::size_t ChunkMask = ChunkSize - 1;
+
+	std::vector<std::unique_ptr<RestingOrder[]>> chunks_;
+	OrderHandle freeHead_{ Constants::InvalidHandle };
+	std::size_t size_{};
+
+	void Grow()
+	{
+		const auto first = Capacity();
+		if (first + ChunkSize > Constants::InvalidHandle)
+		{
+			throw std::length_error(std::format("Order pool cannot grow beyond ({}) orders.", first));
+		}
+
+		chunks_.push_back(std::make_unique<RestingOrder[]>(ChunkSize));
+		auto& chunk = chunks_.back();
+
+		// Note(vss): thread the new nodes onto the free list in ascending order, so fresh handles are handed out sequentially.
+		for (std::size_t index = ChunkSize; index-- > 0; )
+		{
+			chunk[index].link_ = freeHead_;
+			freeHead_ = static_cast<OrderHandle>(first + index);
+		}
+	}
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <memory_resource>
+
+#include "Aliases.h"
+#include "Constants.h"
+
+/**
+* @brief FIFO of the orders resting at one price level, stored as a contiguous ring of entries.
+* An entry is the order's handle and its open quantity, the only fields matching changes, so a fill that leaves an order resting
+* never leaves the ring. Everything else about the order stays in the OrderPool.
+* Every entry has a position that stays valid until the entry leaves the queue, so a cancel in the middle overwrites its slot
+* with a tombstone in O(1) instead of unlinking anything. Tombstones at either end are dropped straight away, the ones in between
+* are squeezed out once they outnumber the live entries. Matching reads a level front to back through one array.
+* The first InlineCapacity entries live inside the queue itself, so the many levels that only ever hold a few orders never allocate.
+* Larger rings come from the allocator's resource, the book hands its levels the same pool resource its node based containers use.
+*/
+class OrderQueue
+{
+public:
+
+	using allocator_type = std::pmr::polymorphic_allocator<>;
+
+	struct Entry
+	{
+		OrderHandle handle_{ Constants::InvalidHandle };
+		Quantity quantity_{};
+	};
+
+	OrderQueue() = default;
+
+	explicit OrderQueue(const allocator_type& allocator) :
+		allocator_{ allocator }
+	{}
+
+	OrderQueue(const OrderQueue& other, const allocator_type& allocator = { }) :
+		allocator_{ allocator }
+	{
+		CopyFrom(other);
+	}
+
+	OrderQueue(OrderQueue&& other) noexcept :
+		allocator_{ other.allocator_ }
+	{
+		if (other.IsInline())
+		{
+			CopyFrom(other);
+			return;
+		}
+
+		slots_ = std::exchange(other.slots_, other.inline_.data());
+		mask_ = std::exchange(other.mask_, InlineCapacity - 1);
+		head_ = std::exchange(other.head_, 0);
+		tail_ = std::exchange(other.tail_, 0);
+		size_ = std::exchange(other.size_, 0);
+	}
+
+	void operator=(const OrderQueue&) = delete;
+	void operator=(OrderQueue&&) = delete;
+
+	~OrderQueue()
+	{
+		if (!IsInline())
+		{
+			allocator_.deallocate_object(slots_, Capacity());
+		}
+	}
+
+	bool Empty() const { return size_ == 0; }
+	std::size_t Size() const { return size_; }
+
+	// Note(vss): the oldest live entry, the queue must not be empty.
+	Entry& Front() { return slots_[head_ & mask_]; }
+	const Entry& Front() const { return slots_[head_ & mask_]; }
+
+	Entry& At(std::uint32_t position) { return slots_[position & mask_]; }
+	const Entry& At(std::uint32_t position) const { return slots_[position & mask_]; }
+
+	// Note(vss): returns the entry's position, which At and Erase take.
+	std::uint32_t PushBack(OrderHandle handle, Quantity quantity)
+	{
+		if (tail_ - head_ == Capacity())
+		{
+			Grow();
+		}
+
+		const auto position = tail_++;
+		slots_[position & mask_] = Entry{ handle, quantity };
+		++size_;
+		return position;
+	}
+
+	void PopFront() { Erase(head_); }
+
+	void Erase(std::uint32_t position)
+	{
+		slots_[position & mask_].handle_ = Constants::InvalidHandle;
+		if (--size_ == 0)
+		{
+			head_ = 0;
+			tail_ = 0;
+			return;
+		}
+
+		while (slots_[head_ & mask_].handle_ == Constants::InvalidHandle)
+		{
+			++head_;
+		}
+		while (slots_[(tail_ - 1) & mask_].handle_ == Constants::InvalidHandle)
+		{
+			--tail_;
+		}
+	}
+
+	bool IsSparse() const { return tail_ - head_ > InlineCapacity && tail_ - head_ > 2 * size_; }
+
+	/**
+	* @brief Moves the live entries down over the tombstones, keeping their order, and reports every entry that moved as onMoved(handle, position).
+	*/
+	template <typename Function>
+	void Compact(Function&& onMoved)
+	{
+		auto to = head_;
+		for (auto from = head_; from != tail_; ++from)
+		{
+			const auto entry = slots_[from & mask_];
+			if (entry.handle_ == Constants::InvalidHandle)
+			{
+				continue;
+			}
+			if (from != to)
+			{
+				slots_[to & mask_] = entry;
+				onMoved(entry.handle_, to);
+			}
+			++to;
+		}
+		tail_ = to;
+	}
+
+	// Note(vss): visits the live entries front to back as function(handle, quantity).
+	template <typename Function>
+	void ForEach(Function&& function) const
+	{
+		for (auto position = head_; position != tail_; ++position)
+		{
+			if (const auto& entry = slots_[position & mask_]; entry.handle_ != Constants::InvalidHandle)
+			{
+				function(entry.handle_, entry.quantity_);
+			}
+		}
+	}
+
+	// Note(vss): bytes of the ring when it has outgrown the inline entries, which are part of the queue itself.
+	std::size_t MemoryUsage() const { return IsInline() ? 0 : Capacity() * sizeof(Entry); }
+
+private:
+
+	static constexpr std::uint32_t InlineCapacity = 4;
+
+	allocator_type allocator_;
+	std::array<Entry, InlineCapacity> inline_{ };
+	Entry* slots_{ inline_.data() };
+	std::uint32_t mask_{ InlineCapacity - 1 };
+	// Note(vss): positions count up forever and wrap with the ring, the slot of a position is position & mask_.
+	std::uint32_t head_{};
+	std::uint32_t tail_{};
+	std::uint32_t size_{};
+
+	bool IsInline() const { return slots_ == inline_.data(); }
+	std::uint32_t Capacity() const { return mask_ + 1; }
+
+	void Grow()
+	{
+		const auto capacity = Capacity() * 2;
+		auto* slots = allocator_.allocate_object<Entry>(capacity);
+		const auto mask = capacity - 1;
+		for (auto position = head_; position != tail_; ++position)
+		{
+			slots[position & mask] = slots_[position & mask_];
+		}
+
+		if (!IsInline())
+		{
+			allocator_.deallocate_object(slots_, Capacity());
+		}
+		slots_ = slots;
+		mask_ = mask;
+	}
+
+	void CopyFrom(const OrderQueue& other)
+	{
+		head_ = other.head_;
+		tail_ = other.tail_;
+		size_ = other.size_;
+		if (other.Capacity() > Capacity())
+		{
+			slots_ = allocator_.allocate_object<Entry>(other.Capacity());
+			mask_ = other.mask_;
+		}
+		for (auto position = head_; position != tail_; ++position)
+		{
+			slots_[position & mask_] = other.slots_[position & other.mask_];
+		}
+	}
+};
\ No newline at end of file
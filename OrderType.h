@@ -1,11 +1,14 @@
 #pragma once
 
+#include <cstdint>
+
 // GTC, F&K
-enum class OrderType
+enum class OrderType : std::uint8_t
 {
 	GoodTillCancel,
 	FillAndKill,
 	FillOrKill,
 	GoodForDay,
 	Market,
+	GoodTillDate,
 };
\ No newline at end of file
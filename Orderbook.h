@@ -1,22 +1,41 @@
 #pragma once
 
-#include <map>
+#include <span>
 #include <mutex>
-#include <thread>
-#include <unordered_map>
-#include <condition_variable>
+#include <optional>
+#include <memory_resource>
 
 #include "Aliases.h"
 #include "Order.h"
+#include "OrderPool.h"
+#include "OrderIdIndex.h"
+#include "BookSide.h"
+#include "SideTraits.h"
+#include "PriceLevel.h"
+#include "Expiry.h"
+#include "ExpiryIndex.h"
+#include "MarketData.h"
+#include "SeqLock.h"
+#include "Journal.h"
+#include "Snapshot.h"
+#include "OrderbookSettings.h"
 #include "OrderModify.h"
+#include "OrderCommand.h"
 #include "OrderbookLevelInfos.h"
+#include "OrderbookMemoryUsage.h"
+#include "Auction.h"
 #include "Trade.h"
+#include "TradeSink.h"
+#include "CommandResults.h"
+#include "Instrumentation.h"
 
 class Orderbook
 {
 public:
 
 	Orderbook();
+	explicit Orderbook(std::size_t orderCapacity);
+	explicit Orderbook(const OrderbookSettings& settings);
 	
 	Orderbook(const Orderbook&) = delete;
 	void operator=(const Orderbook&) = delete;
@@ -28,53 +47,533 @@ public:
 
 	std::size_t Size() const;
 	void CancelOrder(OrderId orderId);
+	// Note(vss): a GoodTillDate order whose expiry has already passed is rejected before it is journaled, it never rests or trades.
+	// GoodForDay orders without an expiry get the day's cutoff at the same point, so the journal records it and replay never reads the clock.
 	Trades AddOrder(OrderPointer order);
+	Trades AddOrder(const Order& order);
+	// Note(vss): a smaller quantity at the same price is amended in place and keeps queue priority, any other amend requeues the order at the back of its level.
 	Trades ModifyOrder(OrderModify order);
+	Trades ApplyCommand(const OrderCommand& command);
+
+	/**
+	* @brief Applies commands in order under a single acquisition of the book and reports each one's outcome and trades into results.
+	* Trades and final state are exactly those of applying the commands one by one, only the lock, the top of book copy and the
+	* market data batch are paid once per call instead of once per command. results is cleared first, reserve it to keep the call allocation free.
+	*/
+	void ApplyCommands(std::span<const OrderCommand> commands, CommandResults& results);
 	OrderbookLevelInfos GetOrderInfos() const;
 
-private:
+	/**
+	* @brief Writes the best bids.size() bid levels and asks.size() ask levels into the caller's buffers, best price first.
+	* Quantities come from the per level aggregates, so no order is visited and nothing is allocated.
+	*/
+	DepthCount GetDepth(std::span<LevelInfo> bids, std::span<LevelInfo> asks) const;
 
-	struct OrderEntry
-	{
-		OrderPointer order_{ nullptr };
-		OrderPointers::iterator location_;
-	};
-	
-	struct LevelData
-	{
-		Quantity quantity_{};
-		Quantity count_{};
+	/**
+	* @brief The worst price an order on side would trade at if it took quantity from the book right now, nullopt if the opposite side holds less.
+	* On a laddered side the cumulative quantity is scanned over a contiguous per tick array with SIMD, see FindCumulative.
+	*/
+	std::optional<Price> GetSweepPrice(Side side, std::uint64_t quantity) const;
 
-		enum class Action
-		{
-			Add,
-			Remove,
-			Match,
-		};
-	};
-
-	std::unordered_map<Price, LevelData> data_;
-	std::unordered_map<OrderId, OrderEntry> orders_;
-	std::map<Price, OrderPointers, std::less<Price>> asks_;
-	std::map<Price, OrderPointers, std::greater<Price>> bids_;
+	/**
+	* @brief Bytes held by the book's order, level and index structures. A resting order is split in two: its handle and open quantity
+	* sit in its level's queue, which is all a partial fill touches, everything else sits in a compact record in the order pool.
+	*/
+	OrderbookMemoryUsage MemoryUsage() const;
+
+	/**
+	* @brief Registers listener for incremental level updates, one MarketDataBatch per command, or per ApplyCommands batch, that changed any level.
+	* Batches are delivered on the calling thread while the book is locked, so the listener must be quick and must not call back into the book.
+	*/
+	void SetMarketDataListener(MarketDataListener listener);
+	MarketDataSnapshot GetMarketDataSnapshot() const;
+
+	/**
+	* @brief Best bid and offer plus the top TopOfBook::Depth levels per side, safe to call from any thread.
+	* It never takes the book lock, it reads a copy the matching path publishes at the end of every command.
+	*/
+	TopOfBook GetTopOfBook() const;
+
+	/**
+	* @brief Applies every intact command of the journal at path to this book and returns how many were applied.
+	* Matching is deterministic, so replaying a book's journal into an empty book rebuilds it and reproduces its trades.
+	* Replayed commands are not journaled again, a book recovering from its own journal keeps appending where the file ends.
+	* Commands up to afterSequence are skipped, pass the sequence returned by LoadSnapshot to replay only the tail.
+	*/
+	std::uint64_t ReplayJournal(const std::string& path, std::uint64_t afterSequence = 0);
+	template <TradeSink Sink>
+	std::uint64_t ReplayJournal(const std::string& path, std::uint64_t afterSequence, Sink&& sink);
+
+	/**
+	* @brief Writes every resting order, level by level in time priority, together with the level aggregates to a flat file.
+	* The file is written next to path and renamed over it, so a crash never leaves a half written snapshot behind.
+	* Returns the journal sequence the snapshot covers, zero for a book without a journal.
+	*/
+	std::uint64_t SaveSnapshot(const std::string& path);
+
+	/**
+	* @brief Rebuilds an empty book from a snapshot without matching anything and returns the journal sequence it covers.
+	*/
+	std::uint64_t LoadSnapshot(const std::string& path);
+
+	// Note(vss): syncs journal records still waiting for a full batch to the disk, owners call it when they go idle.
+	void FlushJournal();
+
+	/**
+	* @brief Cancels up to maxOrders GoodForDay and GoodTillDate orders that are due at now and returns how many it cancelled.
+	* Due orders come straight from the expiry index, nothing else in the book is visited. A return of maxOrders means more may be due,
+	* callers run it again after letting other commands through. Expiries are journaled as cancels, so replay reproduces them exactly.
+	* Synchronized books call it from their own timer, single writer books leave it to their owner.
+	*/
+	std::size_t ExpireOrders(Timestamp now, std::size_t maxOrders = ExpiryBatchSize);
+
+	// Note(vss): when the earliest resting expiry becomes due, DeadlineTimer::NoDeadline if none rests. Owners of single writer books sleep their timer until then.
+	Timestamp GetNextExpiry() const;
+
+	/**
+	* @brief Starts a call phase around the open or close. Until Uncross, orders rest without trading even when they cross, and amends
+	* requeue without trading, so a burst costs one insert per order. Market, FillAndKill and FillOrKill orders are rejected while it lasts.
+	* Does nothing if a call phase is already running. Session changes are journaled like orders, so replay reproduces them.
+	*/
+	void BeginAuction();
+
+	/**
+	* @brief Ends the call phase: every bid and ask that crosses at the price GetIndicativeUncross reports trades at that one price,
+	* best price then time first on both sides, and the book goes back to continuous trading uncrossed. Does nothing outside a call phase.
+	*/
+	Trades Uncross();
+	SessionState GetSessionState() const;
+
+	/**
+	* @brief Where the book would uncross right now, nullopt if nothing crosses, which is always the case during continuous trading.
+	* The most executed quantity wins, then the smallest imbalance, then the lower price if sells are in surplus and the higher one otherwise.
+	*/
+	std::optional<AuctionUncross> GetIndicativeUncross() const;
+
+	// Note(vss): same as above, but every trade is handed to sink as it happens instead of being collected into Trades.
+	template <TradeSink Sink>
+	void AddOrder(const Order& order, Sink&& sink);
+	template <TradeSink Sink>
+	void ModifyOrder(OrderModify order, Sink&& sink);
+	template <TradeSink Sink>
+	void ApplyCommand(const OrderCommand& command, Sink&& sink);
+	template <TradeSink Sink>
+	void Uncross(Sink&& sink);
+
+private:
+
+	// Note(vss): node based containers draw from this resource, so erased nodes are recycled instead of going back to the heap.
+	std::pmr::unsynchronized_pool_resource resource_;
+	OrderPool pool_;
+	OrderIdIndex orders_;
+	BookSide<Side::Sell> asks_;
+	BookSide<Side::Buy> bids_;
+	ExpiryIndex expiries_{ &resource_ };
+	Timestamp goodForDayCutoff_{};
+	SessionState session_{ SessionState::Continuous };
 	
-	std::jthread ordersRemoveThread_;
+	OrderbookThreading threading_;
 	mutable std::mutex ordersMutex_;
-	std::atomic<bool> shutdown_{ false };
-	std::condition_variable shutdownConditionVariable_;
 
-	void RemoveGoodForDayOrders();
+	MarketDataListener marketDataListener_;
+	std::vector<LevelUpdate> levelUpdates_;
+	std::uint64_t marketDataSequence_{};
+	SeqLock<TopOfBook> topOfBook_;
+	bool topOfBookChanged_{ false };
 
-	void CancelOrders(OrderIds const& orderIds);
-	void CancelOrderInternal(OrderId orderId);
+	std::optional<JournalWriter> journal_;
+
+	CallProbe probe_;
+
+	// Note(vss): the due time the expiry timer was last asked for, the timer is only woken for an earlier one.
+	Timestamp nextExpiry_{ DeadlineTimer::NoDeadline };
+	// Note(vss): last member, it is stopped first so its thread never sees a half destroyed book.
+	std::optional<DeadlineTimer> expiryTimer_;
+
+	std::unique_lock<std::mutex> LockOrders() const;
+	std::unique_lock<std::mutex> LockOrders(ProbeOperation operation);
+
+	Timestamp GetGoodForDayExpiry();
+	void ScheduleExpiry(Timestamp expiry);
+	bool StampArrival(OrderCommand& command);
+	bool CancelOrderInternal(OrderId orderId);
+
+	template <Side S>
+	auto& GetBookSide();
+	template <Side S>
+	const auto& GetBookSide() const;
 	
-	void OnOrderAdded(OrderPointer order);
-	void OnOrderCancelled(OrderPointer order);
-	void OnOrderMatched(Price price, Quantity quantity, bool isFullyFilled);
+	template <Side S>
+	void OnOrderAdded(Price price, LevelData& data, Quantity quantity);
+	template <Side S>
+	void OnOrderCancelled(Price price, LevelData& data, Quantity quantity);
+	template <Side S>
+	void OnOrderMatched(Price price, LevelData& data, Quantity quantity, bool filled);
 	
-	void UpdateLevelData(Price price, Quantity quantity, LevelData::Action action);
+	template <Side S>
+	void UpdateLevelData(Price price, LevelData& data, Quantity quantity, LevelData::Action action);
+	void PublishMarketData();
+	void FinishCommand();
+	static ProbeOperation ToProbeOperation(CommandType type);
+	void PublishTopOfBook();
+
+	template <Side S>
+	bool CanFullyFill(Price price, Quantity quantity) const;
+	template <Side S>
+	bool CanMatch(Price price) const;
+	template <Side S>
+	bool PrepareOrder(Order& order);
+	template <Side S>
+	void RestOrder(const Order& order);
+	template <Side S>
+	void LinkOrder(OrderHandle handle, Quantity quantity);
+	template <Side S>
+	void UnlinkOrder(OrderHandle handle);
+	template <Side S>
+	void ReduceOrder(OrderHandle handle, Quantity quantity);
+	template <Side S>
+	Quantity GetRemainingQuantity(OrderHandle handle);
+	void AppendToJournal(const OrderCommand& command);
+
+	bool BeginAuctionInternal();
+	std::optional<AuctionUncross> FindUncross() const;
+	template <Side S>
+	void FillBestOrder(Quantity quantity);
+
+	// Note(vss): the overloads without a Side find the side of the order once and call the ones instantiated for it.
+	template <TradeSink Sink>
+	CommandOutcome AddOrderInternal(const Order& order, Sink& sink);
+	template <Side S, TradeSink Sink>
+	CommandOutcome AddOrderInternal(const Order& order, Sink& sink);
+	template <TradeSink Sink>
+	CommandOutcome ModifyOrderInternal(OrderModify order, Sink& sink);
+	template <Side S, TradeSink Sink>
+	CommandOutcome ModifyOrderInternal(OrderHandle handle, OrderModify order, Sink& sink);
+	template <Side S, TradeSink Sink>
+	CommandOutcome RequeueOrder(OrderHandle handle, Order& order, Sink& sink);
+	template <TradeSink Sink>
+	CommandOutcome ApplyCommandInternal(const OrderCommand& command, Sink& sink);
+	template <Side S, TradeSink Sink>
+	void MatchIncoming(Order& order, Sink& sink);
+	template <TradeSink Sink>
+	bool UncrossInternal(Sink& sink);
+};
+
+template <TradeSink Sink>
+void Orderbook::AddOrder(const Order& order, Sink&& sink)
+{
+	const auto ordersLock = LockOrders(ProbeOperation::Add);
+
+	auto command = OrderCommand::Add(order);
+	if (StampArrival(command))
+	{
+		AppendToJournal(command);
+		AddOrderInternal(command.ToOrder(), sink);
+	}
+	FinishCommand();
+}
+
+template <TradeSink Sink>
+void Orderbook::ModifyOrder(OrderModify order, Sink&& sink)
+{
+	const auto ordersLock = LockOrders(ProbeOperation::Modify);
+
+	AppendToJournal(OrderCommand::Modify(order));
+	ModifyOrderInternal(order, sink);
+	FinishCommand();
+}
+
+template <TradeSink Sink>
+void Orderbook::ApplyCommand(const OrderCommand& command, Sink&& sink)
+{
+	const auto ordersLock = LockOrders(ToProbeOperation(command.type_));
+
+	auto stamped = command;
+	if (StampArrival(stamped))
+	{
+		AppendToJournal(stamped);
+		ApplyCommandInternal(stamped, sink);
+	}
+	FinishCommand();
+}
+
+template <TradeSink Sink>
+void Orderbook::Uncross(Sink&& sink)
+{
+	const auto ordersLock = LockOrders(ProbeOperation::Session);
+
+	AppendToJournal(OrderCommand::Uncross());
+	UncrossInternal(sink);
+	FinishCommand();
+}
+
+template <TradeSink Sink>
+std::uint64_t Orderbook::ReplayJournal(const std::string& path, std::uint64_t afterSequence, Sink&& sink)
+{
+	const JournalReader reader{ path };
+	const auto ordersLock = LockOrders();
+
+	return reader.ForEachCommand([&](const OrderCommand& command)
+		{
+			ApplyCommandInternal(command, sink);
+			PublishMarketData();
+		}, afterSequence);
+}
+
+template <Side S>
+auto& Orderbook::GetBookSide()
+{
+	if constexpr (S == Side::Buy)
+	{
+		return bids_;
+	}
+	else
+	{
+		return asks_;
+	}
+}
+
+template <Side S>
+const auto& Orderbook::GetBookSide() const
+{
+	if constexpr (S == Side::Buy)
+	{
+		return bids_;
+	}
+	else
+	{
+		return asks_;
+	}
+}
+
+template <TradeSink Sink>
+CommandOutcome Orderbook::AddOrderInternal(const Order& order, Sink& sink)
+{
+	return DispatchSide(order.GetSide(), [&]<Side S>(SideConstant<S>) { return AddOrderInternal<S>(order, sink); });
+}
+
+template <Side S, TradeSink Sink>
+CommandOutcome Orderbook::AddOrderInternal(const Order& incoming, Sink& sink)
+{
+	Order order{ incoming };
+	const bool prepared = PrepareOrder<S>(order);
+	probe_.Mark(ProbePhase::Book);
+	if (!prepared)
+	{
+		return CommandOutcome::Rejected;
+	}
+
+	// Note(vss): the order trades against the opposite side before it rests, so an order that fills never touches its own side or orders_.
+	MatchIncoming<S>(order, sink);
+	probe_.Mark(ProbePhase::Match);
+
+	if (order.IsFilled())
+	{
+		return CommandOutcome::Filled;
+	}
+	if (order.GetOrderType() == OrderType::FillAndKill || order.GetOrderType() == OrderType::FillOrKill)
+	{
+		return CommandOutcome::Killed;
+	}
+
+	RestOrder<S>(order);
+	probe_.Mark(ProbePhase::Book);
+	return CommandOutcome::Rested;
+}
+
+template <TradeSink Sink>
+CommandOutcome Orderbook::ModifyOrderInternal(OrderModify modify, Sink& sink)
+{
+	const auto handle = orders_.Find(modify.GetOrderId());
+	if (handle == Constants::InvalidHandle)
+	{
+		return CommandOutcome::NotFound;
+	}
+	if (modify.GetQuantity() == 0)
+	{
+		CancelOrderInternal(modify.GetOrderId());
+		return CommandOutcome::Cancelled;
+	}
+
+	return DispatchSide(pool_.Get(handle).side_, [&]<Side S>(SideConstant<S>) { return ModifyOrderInternal<S>(handle, modify, sink); });
+}
+
+// Note(vss): S is the side the order rests on, an amend that changes side is requeued on the other one.
+template <Side S, TradeSink Sink>
+CommandOutcome Orderbook::ModifyOrderInternal(OrderHandle handle, OrderModify modify, Sink& sink)
+{
+	const auto& resting = pool_.Get(handle);
+
+	// Note(vss): a smaller order at the same price keeps its place in the queue.
+	if (modify.GetSide() == S && modify.GetPrice() == resting.price_)
+	{
+		const auto remainingQuantity = GetRemainingQuantity<S>(handle);
+		if (modify.GetQuantity() <= remainingQuantity)
+		{
+			if (modify.GetQuantity() != remainingQuantity)
+			{
+				ReduceOrder<S>(handle, remainingQuantity - modify.GetQuantity());
+			}
+			probe_.Mark(ProbePhase::Book);
+			return CommandOutcome::Rested;
+		}
+	}
+
+	// Note(vss): anything else goes to the back of its new level, it keeps its handle and may trade on the way like an incoming order.
+	UnlinkOrder<S>(handle);
+	Order order{ resting.orderType_, resting.orderId_, modify.GetSide(), modify.GetPrice(), modify.GetQuantity(), resting.expiry_ };
+	probe_.Mark(ProbePhase::Book);
+
+	if (modify.GetSide() == S)
+	{
+		return RequeueOrder<S>(handle, order, sink);
+	}
+	return RequeueOrder<SideTraits<S>::Opposite>(handle, order, sink);
+}
+
+template <Side S, TradeSink Sink>
+CommandOutcome Orderbook::RequeueOrder(OrderHandle handle, Order& order, Sink& sink)
+{
+	MatchIncoming<S>(order, sink);
+	probe_.Mark(ProbePhase::Match);
+
+	if (order.IsFilled())
+	{
+		if (order.HasExpiry())
+		{
+			expiries_.Remove(handle);
+		}
+		orders_.Erase(order.GetOrderId());
+		pool_.Release(handle);
+		return CommandOutcome::Filled;
+	}
+
+	pool_.Get(handle) = RestingOrder{ order };
+	LinkOrder<S>(handle, order.GetRemainingQuantity());
+	probe_.Mark(ProbePhase::Book);
+	return CommandOutcome::Rested;
+}
+
+template <TradeSink Sink>
+CommandOutcome Orderbook::ApplyCommandInternal(const OrderCommand& command, Sink& sink)
+{
+	switch (command.type_)
+	{
+	case CommandType::Add:
+		return AddOrderInternal(command.ToOrder(), sink);
+	case CommandType::Modify:
+		return ModifyOrderInternal(command.ToOrderModify(), sink);
+	case CommandType::Cancel:
+		return CancelOrderInternal(command.orderId_) ? CommandOutcome::Cancelled : CommandOutcome::NotFound;
+	case CommandType::BeginAuction:
+		return BeginAuctionInternal() ? CommandOutcome::SessionChanged : CommandOutcome::Rejected;
+	case CommandType::Uncross:
+		return UncrossInternal(sink) ? CommandOutcome::SessionChanged : CommandOutcome::Rejected;
+	default:
+		throw std::logic_error("Unsupported command type.");
+	}
+}
+
+template <Side S, TradeSink Sink>
+void Orderbook::MatchIncoming(Order& order, Sink& sink)
+{
+	// Note(vss): in a call phase orders only accumulate, the uncross matches them all at once.
+	if (session_ == SessionState::Auction)
+	{
+		return;
+	}
+
+	constexpr Side Opposite = SideTraits<S>::Opposite;
+	auto& opposite = GetBookSide<Opposite>();
+
+	while (!order.IsFilled() && !opposite.Empty())
+	{
+		const auto price = opposite.BestPrice();
+		if (!SideTraits<S>::Crosses(order.GetPrice(), price))
+		{
+			break;
+		}
+
+		auto& level = opposite.BestLevel();
+		probe_.Count(ProbeCounter::LevelsTouched);
+		while (!order.IsFilled() && !level.Empty())
+		{
+			// Note(vss): the open quantity is in the queue entry, the pool is only read for the resting order's id.
+			auto& entry = level.orders_.Front();
+			const auto handle = entry.handle_;
+			const auto quantity = std::min(order.GetRemainingQuantity(), entry.quantity_);
+
+			order.Fill(quantity);
+			entry.quantity_ -= quantity;
+			const bool filled = entry.quantity_ == 0;
+
+			const auto& resting = pool_.Get(handle);
+			const TradeInfo incomingTrade{ order.GetOrderId(), order.GetPrice(), quantity };
+			const TradeInfo restingTrade{ resting.orderId_, price, quantity };
+			if constexpr (S == Side::Buy)
+			{
+				sink(Trade{ incomingTrade, restingTrade });
+			}
+			else
+			{
+				sink(Trade{ restingTrade, incomingTrade });
+			}
+			probe_.Count(ProbeCounter::Trades);
+
+			OnOrderMatched<Opposite>(price, level.data_, quantity, filled);
+
+			if (filled)
+			{
+				probe_.Count(ProbeCounter::OrdersMatched);
+				if (resting.HasExpiry())
+				{
+					expiries_.Remove(handle);
+				}
+				pool_.PopFront(level.orders_);
+				orders_.Erase(resting.orderId_);
+				pool_.Release(handle);
+			}
+		}
+
+		if (level.Empty())
+		{
+			opposite.Erase(price);
+		}
+	}
+}
+
+template <TradeSink Sink>
+bool Orderbook::UncrossInternal(Sink& sink)
+{
+	if (session_ != SessionState::Auction)
+	{
+		return false;
+	}
+	session_ = SessionState::Continuous;
+
+	const auto uncross = FindUncross();
+	probe_.Mark(ProbePhase::Book);
+	if (!uncross.has_value())
+	{
+		return true;
+	}
+
+	// Note(vss): bids and asks priced through the uncross price hold at least quantity_ each and are taken best first,
+	// so the front of either best level always crosses while quantity_ trades, and nothing that still crosses is left afterwards.
+	const auto price = uncross->price_;
+	for (auto remaining = uncross->quantity_; remaining != 0;)
+	{
+		const auto& bid = bids_.BestLevel().orders_.Front();
+		const auto& ask = asks_.BestLevel().orders_.Front();
+		const auto quantity = std::min(bid.quantity_, ask.quantity_);
+
+		sink(Trade{ TradeInfo{ pool_.Get(bid.handle_).orderId_, price, quantity }, TradeInfo{ pool_.Get(ask.handle_).orderId_, price, quantity } });
+		probe_.Count(ProbeCounter::Trades);
 
-	bool CanFullyFill(Side side, Price price, Quantity quantity) const;
-	bool CanMatch(Side side, Price price) const;
-	Trades MatchOrders();
-};
\ No newline at end of file
+		FillBestOrder<Side::Buy>(quantity);
+		FillBestOrder<Side::Sell>(quantity);
+		remaining -= quantity;
+	}
+	probe_.Mark(ProbePhase::Match);
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,452 @@
+#include <array>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <memory>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../Orderbook.h"
+
+/**
+* @brief How the resting orders' prices spread away from the touch on each side.
+* Narrow piles many orders onto few levels, Sparse leaves most levels with a single order.
+*/
+enum class PriceDistribution
+{
+	Narrow,
+	Wide,
+	Sparse,
+};
+
+// Note(vss): narrow builds shrink the mid and the sparse spread so every price still fits in Price.
+constexpr Price MidPrice = static_cast<Price>(std::min<std::int64_t>(1'000'000, std::numeric_limits<Price>::max() / 2));
+constexpr std::array<Price, 3> PriceSpreads{ 10, 1'000, static_cast<Price>(std::min<std::int64_t>(100'000, MidPrice / 2)) };
+
+// Note(vss): operations timed per batch rather than one by one, so clock reads stay out of the result.
+constexpr std::size_t BatchSize = 1'000;
+
+/**
+* @brief A single writer book preloaded with depth resting orders split evenly between bids and asks, plus the
+* bookkeeping benchmarks need to undo their changes between batches. Everything is seeded, so runs are repeatable.
+* Ladder books give every price either side of the mid can rest at a tick of the price ladder.
+*/
+class BenchmarkBook
+{
+public:
+
+	BenchmarkBook(std::size_t depth, PriceDistribution distribution, bool ladder) :
+		spread_{ PriceSpreads[static_cast<std::size_t>(distribution)] }
+	{
+		OrderbookSettings settings{ .orderCapacity_ = depth + BatchSize * 4, .threading_ = OrderbookThreading::SingleWriter };
+		if (ladder)
+		{
+			settings.ladder_ = LadderSettings{ 1, static_cast<Price>(MidPrice - spread_), static_cast<Price>(MidPrice + spread_) };
+		}
+		orderbook_ = std::make_unique<Orderbook>(settings);
+
+		orders_.reserve(depth);
+		for (std::size_t index = 0; index < depth; ++index)
+		{
+			const auto side = index % 2 == 0 ? Side::Buy : Side::Sell;
+			const Order order{ OrderType::GoodTillCancel, NextOrderId(), side, PassivePrice(side), NextQuantity() };
+			orderbook_->AddOrder(order, [](const Trade&) {});
+			orders_.push_back(order);
+			indices_.push_back(index);
+		}
+	}
+
+	Orderbook& Get() { return *orderbook_; }
+	std::vector<Order>& GetOrders() { return orders_; }
+
+	OrderId NextOrderId() { return ++lastOrderId_; }
+	Quantity NextQuantity() { return std::uniform_int_distribution<Quantity>{ 1, 100 }(random_); }
+
+	// Note(vss): a price that rests on side without crossing, drawn from the book's distribution.
+	Price PassivePrice(Side side)
+	{
+		const auto offset = std::uniform_int_distribution<Price>{ 0, static_cast<Price>(spread_ - 1) }(random_);
+		return side == Side::Buy ? MidPrice - 1 - offset : MidPrice + 1 + offset;
+	}
+
+	// Note(vss): up to count distinct indices into GetOrders(), a partial shuffle keeps this proportional to count rather than depth.
+	std::span<const std::size_t> SampleIndices(std::size_t count)
+	{
+		count = std::min(count, indices_.size());
+		for (std::size_t index = 0; index < count; ++index)
+		{
+			std::swap(indices_[index], indices_[std::uniform_int_distribution<std::size_t>{ index, indices_.size() - 1 }(random_)]);
+		}
+		return std::span{ indices_ }.first(count);
+	}
+
+	TopOfBook GetTopOfBook() const { return orderbook_->GetTopOfBook(); }
+
+private:
+
+	std::unique_ptr<Orderbook> orderbook_;
+	std::vector<Order> orders_;
+	std::vector<std::size_t> indices_;
+	std::mt19937_64 random_{ 20240521 };
+	Price spread_;
+	OrderId lastOrderId_{};
+};
+
+template <typename Function>
+double TimeSeconds(Function&& function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Note(vss): items_per_second is the number to compare, the reported time covers a whole batch.
+void SetCounters(benchmark::State& state, std::size_t operations)
+{
+	state.SetItemsProcessed(static_cast<std::int64_t>(operations));
+}
+
+BenchmarkBook MakeBook(const benchmark::State& state)
+{
+	return BenchmarkBook{ static_cast<std::size_t>(state.range(0)), static_cast<PriceDistribution>(state.range(1)), state.range(2) != 0 };
+}
+
+// Note(vss): orders that rest without trading, cancelled again outside the timed region.
+void BM_AddOrderPassive(benchmark::State& state)
+{
+	auto book = MakeBook(state);
+	std::vector<Order> batch;
+	batch.reserve(BatchSize);
+
+	for (auto _ : state)
+	{
+		batch.clear();
+		for (std::size_t index = 0; index < BatchSize; ++index)
+		{
+			const auto side = index % 2 == 0 ? Side::Buy : Side::Sell;
+			batch.emplace_back(OrderType::GoodTillCancel, book.NextOrderId(), side, book.PassivePrice(side), book.NextQuantity());
+		}
+
+		state.SetIterationTime(TimeSeconds([&]
+			{
+				for (const auto& order : batch)
+				{
+					book.Get().AddOrder(order, [](const Trade&) {});
+				}
+			}));
+
+		for (const auto& order : batch)
+		{
+			book.Get().CancelOrder(order.GetOrderId());
+		}
+	}
+
+	SetCounters(state, state.iterations() * BatchSize);
+}
+
+// Note(vss): one lot FillAndKill orders against the touch, never more than the touch holds, and the liquidity they take is put back after each batch.
+void BM_AddOrderAggressive(benchmark::State& state)
+{
+	auto book = MakeBook(state);
+	std::vector<Order> batch;
+	batch.reserve(BatchSize);
+	std::size_t operations{};
+
+	for (auto _ : state)
+	{
+		const auto topOfBook = book.GetTopOfBook();
+		if (topOfBook.bidCount_ == 0 || topOfBook.askCount_ == 0)
+		{
+			state.SkipWithError("The book needs both sides to trade against.");
+			break;
+		}
+
+		const auto buys = std::min<std::size_t>(BatchSize / 2, topOfBook.asks_[0].quantity_);
+		const auto sells = std::min<std::size_t>(BatchSize / 2, topOfBook.bids_[0].quantity_);
+
+		batch.clear();
+		for (std::size_t index = 0; index < buys + sells; ++index)
+		{
+			const auto side = index < buys ? Side::Buy : Side::Sell;
+			const auto price = side == Side::Buy ? topOfBook.asks_[0].price_ : topOfBook.bids_[0].price_;
+			batch.emplace_back(OrderType::FillAndKill, book.NextOrderId(), side, price, Quantity{ 1 });
+		}
+
+		state.SetIterationTime(TimeSeconds([&]
+			{
+				for (const auto& order : batch)
+				{
+					book.Get().AddOrder(order, [](const Trade&) {});
+				}
+			}));
+		operations += batch.size();
+
+		book.Get().AddOrder(Order{ OrderType::GoodTillCancel, book.NextOrderId(), Side::Sell, topOfBook.asks_[0].price_, static_cast<Quantity>(buys) }, [](const Trade&) {});
+		book.Get().AddOrder(Order{ OrderType::GoodTillCancel, book.NextOrderId(), Side::Buy, topOfBook.bids_[0].price_, static_cast<Quantity>(sells) }, [](const Trade&) {});
+	}
+
+	SetCounters(state, operations);
+}
+
+// Note(vss): cancels distinct random resting orders, which are added back outside the timed region.
+void BM_CancelOrder(benchmark::State& state)
+{
+	auto book = MakeBook(state);
+	std::size_t operations{};
+
+	for (auto _ : state)
+	{
+		const auto batch = book.SampleIndices(BatchSize);
+
+		state.SetIterationTime(TimeSeconds([&]
+			{
+				for (const auto index : batch)
+				{
+					book.Get().CancelOrder(book.GetOrders()[index].GetOrderId());
+				}
+			}));
+		operations += batch.size();
+
+		for (const auto index : batch)
+		{
+			book.Get().AddOrder(book.GetOrders()[index], [](const Trade&) {});
+		}
+	}
+
+	SetCounters(state, operations);
+}
+
+// Note(vss): moves distinct random resting orders to another passive price on their side, the book keeps its size.
+void BM_ModifyOrder(benchmark::State& state)
+{
+	auto book = MakeBook(state);
+	std::vector<OrderModify> batch;
+	batch.reserve(BatchSize);
+	std::size_t operations{};
+
+	for (auto _ : state)
+	{
+		batch.clear();
+		for (const auto index : book.SampleIndices(BatchSize))
+		{
+			auto& order = book.GetOrders()[index];
+			order = Order{ OrderType::GoodTillCancel, order.GetOrderId(), order.GetSide(), book.PassivePrice(order.GetSide()), book.NextQuantity() };
+			batch.emplace_back(order.GetOrderId(), order.GetSide(), order.GetPrice(), order.GetInitialQuantity());
+		}
+
+		state.SetIterationTime(TimeSeconds([&]
+			{
+				for (const auto& modify : batch)
+				{
+					book.Get().ModifyOrder(modify, [](const Trade&) {});
+				}
+			}));
+		operations += batch.size();
+	}
+
+	SetCounters(state, operations);
+}
+
+// Note(vss): one buy that takes out the best ten ask levels completely, the filled orders are restored afterwards.
+void BM_MatchOrdersSweep(benchmark::State& state)
+{
+	constexpr std::size_t SweptLevels = 10;
+
+	auto book = MakeBook(state);
+	std::vector<TradeInfo> filled;
+
+	for (auto _ : state)
+	{
+		std::array<LevelInfo, SweptLevels> asks{ };
+		const auto [bidCount, askCount] = book.Get().GetDepth({ }, asks);
+		if (askCount == 0)
+		{
+			state.SkipWithError("The book has no asks to sweep.");
+			break;
+		}
+
+		// Note(vss): narrow builds cap the sweep at what Quantity holds, it then stops inside the last levels instead of clearing them.
+		std::uint64_t quantity{};
+		for (std::size_t index = 0; index < askCount; ++index)
+		{
+			quantity += asks[index].quantity_;
+		}
+
+		filled.clear();
+		const Order sweep{ OrderType::FillAndKill, book.NextOrderId(), Side::Buy, asks[askCount - 1].price_,
+			static_cast<Quantity>(std::min<std::uint64_t>(quantity, std::numeric_limits<Quantity>::max())) };
+
+		state.SetIterationTime(TimeSeconds([&]
+			{
+				book.Get().AddOrder(sweep, [&filled](const Trade& trade) { filled.push_back(trade.GetAskTrade()); });
+			}));
+
+		for (const auto& trade : filled)
+		{
+			book.Get().AddOrder(Order{ OrderType::GoodTillCancel, trade.orderId_, Side::Sell, trade.price_, trade.quantity_ }, [](const Trade&) {});
+		}
+	}
+
+	SetCounters(state, state.iterations());
+}
+
+/**
+* @brief A FillOrKill buy limited at the middle ask level, for extra more than the asks up to that level hold, so the check has
+* to sum the levels within the limit rather than answer from the side's total. Narrow builds stop at an earlier level once the
+* quantity would no longer fit in Quantity, nullopt if even the best level does not.
+*/
+std::optional<Order> MakeMidBookFillOrKill(BenchmarkBook& book, std::uint64_t extra)
+{
+	const auto infos = book.Get().GetOrderInfos();
+	const auto& asks = infos.GetAsks();
+
+	std::uint64_t available{};
+	std::optional<Price> limit;
+	for (std::size_t index = 0; index < asks.size() && index <= asks.size() / 2; ++index)
+	{
+		if (available + asks[index].quantity_ + extra > std::numeric_limits<Quantity>::max())
+		{
+			break;
+		}
+		available += asks[index].quantity_;
+		limit = asks[index].price_;
+	}
+
+	if (!limit.has_value())
+	{
+		return std::nullopt;
+	}
+	return Order{ OrderType::FillOrKill, book.NextOrderId(), Side::Buy, limit.value(), static_cast<Quantity>(available + extra) };
+}
+
+// Note(vss): one lot more than the asks within the limit hold, so every order is rejected untouched.
+void BM_FillOrKillReject(benchmark::State& state)
+{
+	auto book = MakeBook(state);
+	const auto order = MakeMidBookFillOrKill(book, 1);
+	if (!order.has_value())
+	{
+		state.SkipWithError("No ask level is within reach of an order quantity.");
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		book.Get().AddOrder(order.value(), [](const Trade&) {});
+	}
+
+	SetCounters(state, state.iterations());
+}
+
+// Note(vss): exactly what the asks within the limit hold, so every order passes the check and fills, the filled orders are restored afterwards.
+void BM_FillOrKillFill(benchmark::State& state)
+{
+	auto book = MakeBook(state);
+	const auto order = MakeMidBookFillOrKill(book, 0);
+	if (!order.has_value())
+	{
+		state.SkipWithError("No ask level is within reach of an order quantity.");
+		return;
+	}
+
+	std::vector<TradeInfo> filled;
+	for (auto _ : state)
+	{
+		filled.clear();
+		state.SetIterationTime(TimeSeconds([&]
+			{
+				book.Get().AddOrder(order.value(), [&filled](const Trade& trade) { filled.push_back(trade.GetAskTrade()); });
+			}));
+
+		for (const auto& trade : filled)
+		{
+			book.Get().AddOrder(Order{ OrderType::GoodTillCancel, trade.orderId_, Side::Sell, trade.price_, trade.quantity_ }, [](const Trade&) {});
+		}
+	}
+
+	SetCounters(state, state.iterations());
+}
+
+void BM_GetOrderInfos(benchmark::State& state)
+{
+	auto book = MakeBook(state);
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(book.Get().GetOrderInfos());
+	}
+
+	SetCounters(state, state.iterations());
+}
+
+// Note(vss): copies up to DepthLevels levels a side, long enough for the level scan rather than the bitmap walk to serve it.
+void BM_GetDepth(benchmark::State& state)
+{
+	constexpr std::size_t DepthLevels = 1'000;
+
+	auto book = MakeBook(state);
+	std::vector<LevelInfo> bids(DepthLevels);
+	std::vector<LevelInfo> asks(DepthLevels);
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(book.Get().GetDepth(bids, asks));
+		benchmark::ClobberMemory();
+	}
+
+	SetCounters(state, state.iterations());
+}
+
+// Note(vss): the price a buy for half of the resting ask quantity would sweep to.
+void BM_GetSweepPrice(benchmark::State& state)
+{
+	auto book = MakeBook(state);
+	const auto infos = book.Get().GetOrderInfos();
+
+	std::uint64_t quantity{};
+	for (const auto& level : infos.GetAsks())
+	{
+		quantity += level.quantity_;
+	}
+	quantity = std::max<std::uint64_t>(quantity / 2, 1);
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(book.Get().GetSweepPrice(Side::Buy, quantity));
+	}
+
+	SetCounters(state, state.iterations());
+}
+
+void BookShapes(benchmark::internal::Benchmark* benchmark)
+{
+	benchmark->ArgNames({ "depth", "prices", "ladder" });
+	for (std::int64_t depth = 10; depth <= 1'000'000; depth *= 10)
+	{
+		for (std::int64_t distribution = 0; distribution < static_cast<std::int64_t>(PriceSpreads.size()); ++distribution)
+		{
+			for (const std::int64_t ladder : { 0, 1 })
+			{
+				benchmark->Args({ depth, distribution, ladder });
+			}
+		}
+	}
+}
+
+BENCHMARK(BM_AddOrderPassive)->Apply(BookShapes)->UseManualTime();
+BENCHMARK(BM_AddOrderAggressive)->Apply(BookShapes)->UseManualTime();
+BENCHMARK(BM_CancelOrder)->Apply(BookShapes)->UseManualTime();
+BENCHMARK(BM_ModifyOrder)->Apply(BookShapes)->UseManualTime();
+BENCHMARK(BM_MatchOrdersSweep)->Apply(BookShapes)->UseManualTime();
+BENCHMARK(BM_FillOrKillReject)->Apply(BookShapes);
+BENCHMARK(BM_FillOrKillFill)->Apply(BookShapes)->UseManualTime();
+BENCHMARK(BM_GetOrderInfos)->Apply(BookShapes);
+BENCHMARK(BM_GetDepth)->Apply(BookShapes);
+BENCHMARK(BM_GetSweepPrice)->Apply(BookShapes);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,196 @@
+#include <array>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <filesystem>
+#include <format>
+
+#include "../OrderFlowGenerator.h"
+#include "../CommandParser.h"
+#include "../Journal.h"
+
+struct GeneratorOptions
+{
+	std::string path_;
+	std::uint64_t count_{ 1'000'000 };
+	bool binary_{ false };
+	OrderFlowSettings flow_;
+};
+
+// Note(vss): text is flushed in chunks of about this size, so writing keeps pace with generating.
+constexpr std::size_t TextChunkSize = 1 << 20;
+
+/**
+* @brief Writes count generated commands to path, either as text in the OrderbookTests/TestFolder format or as a binary
+* journal, both of which OrderbookReplay reads. Arrival times shape the stream's bursts but are not stored in either format.
+*/
+static void Generate(const GeneratorOptions& options, std::ostream& output)
+{
+	OrderFlowGenerator generator{ options.flow_ };
+	std::array<std::uint64_t, 3> counts{ };
+	std::uint64_t lastTimestamp{};
+
+	std::filesystem::remove(options.path_);
+
+	std::optional<JournalWriter> journal;
+	std::ofstream text;
+	std::string buffer;
+	if (options.binary_)
+	{
+		journal.emplace(JournalSettings{ .path_ = options.path_, .syncPolicy_ = JournalSyncPolicy::None, .batchSize_ = 4096 });
+	}
+	else
+	{
+		text.open(options.path_, std::ios::binary);
+		if (!text)
+		{
+			throw std::logic_error(std::format("Cannot open ({}) for writing.", options.path_));
+		}
+		buffer.reserve(TextChunkSize + 64);
+	}
+
+	for (std::uint64_t index = 0; index < options.count_; ++index)
+	{
+		const auto [command, timestamp] = generator.Next();
+		++counts[static_cast<std::size_t>(command.type_)];
+		lastTimestamp = timestamp;
+
+		if (journal)
+		{
+			journal->Append(command);
+			continue;
+		}
+
+		CommandParser::AppendCommand(buffer, command);
+		if (buffer.size() >= TextChunkSize)
+		{
+			text.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+			buffer.clear();
+		}
+	}
+
+	if (journal)
+	{
+		journal->Flush();
+	}
+	else
+	{
+		text.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		if (!text.flush())
+		{
+			throw std::logic_error(std::format("Failed to write ({}).", options.path_));
+		}
+	}
+
+	const auto seconds = static_cast<double>(lastTimestamp) / 1e9;
+	output << std::format("commands {}: add {}, modify {}, cancel {}, left resting {}\n", options.count_, counts[0], counts[1], counts[2], generator.GetLiveCount());
+	output << std::format("arrivals span {:.3f} s, {:.0f} commands/s on average\n", seconds, seconds == 0.0 ? 0.0 : static_cast<double>(options.count_) / seconds);
+}
+
+static void PrintUsage()
+{
+	std::cerr << "usage: OrderbookGenerator <file> [--count <commands>] [--seed <seed>] [--binary]\n"
+		"  [--mix <add> <cancel> <modify>] [--types <GoodTillCancel> <FillAndKill> <FillOrKill> <GoodForDay> <Market> <GoodTillDate>]\n"
+		"  [--touch <mean ticks from touch> <aggressive probability>] [--quantity <median> <sigma> <lot>]\n"
+		"  [--bursts <probability> <mean length>] [--opening <orders>]\n"
+		"  Weights are relative. The same seed and options always produce the same file.\n";
+}
+
+static GeneratorOptions ParseOptions(int argc, char* argv[])
+{
+	GeneratorOptions options;
+	auto& flow = options.flow_;
+
+	auto NextArgument = [&](int& index) -> const char*
+		{
+			if (++index >= argc)
+			{
+				throw std::logic_error(std::format("Missing value after ({}).", argv[index - 1]));
+			}
+			return argv[index];
+		};
+	auto NextNumber = [&](int& index) { return std::stoull(NextArgument(index)); };
+	auto NextReal = [&](int& index) { return std::stod(NextArgument(index)); };
+
+	for (int index = 1; index < argc; ++index)
+	{
+		const std::string_view argument{ argv[index] };
+		if (argument == "--count")
+		{
+			options.count_ = NextNumber(index);
+		}
+		else if (argument == "--seed")
+		{
+			flow.seed_ = NextNumber(index);
+		}
+		else if (argument == "--binary")
+		{
+			options.binary_ = true;
+		}
+		else if (argument == "--mix")
+		{
+			flow.addWeight_ = NextReal(index);
+			flow.cancelWeight_ = NextReal(index);
+			flow.modifyWeight_ = NextReal(index);
+		}
+		else if (argument == "--types")
+		{
+			for (auto& weight : flow.orderTypeWeights_)
+			{
+				weight = NextReal(index);
+			}
+		}
+		else if (argument == "--touch")
+		{
+			flow.meanTicksFromTouch_ = NextReal(index);
+			flow.aggressiveProbability_ = NextReal(index);
+		}
+		else if (argument == "--quantity")
+		{
+			flow.medianQuantity_ = static_cast<Quantity>(NextNumber(index));
+			flow.quantitySigma_ = NextReal(index);
+			flow.lotSize_ = static_cast<Quantity>(NextNumber(index));
+		}
+		else if (argument == "--bursts")
+		{
+			flow.burstProbability_ = NextReal(index);
+			flow.meanBurstLength_ = NextReal(index);
+		}
+		else if (argument == "--opening")
+		{
+			flow.openingBurst_ = static_cast<std::size_t>(NextNumber(index));
+		}
+		else if (options.path_.empty() && !argument.starts_with("--"))
+		{
+			options.path_ = argument;
+		}
+		else
+		{
+			throw std::logic_error(std::format("Unknown argument ({}).", argument));
+		}
+	}
+
+	if (options.path_.empty())
+	{
+		throw std::logic_error("No output file given.");
+	}
+
+	return options;
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		Generate(ParseOptions(argc, argv), std::cout);
+		return 0;
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << exception.what() << '\n';
+		PrintUsage();
+		return 1;
+	}
+}
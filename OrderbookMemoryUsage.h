@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+// Note(vss): what a std::map node costs on top of its value, three links and a colour on the common implementations.
+constexpr std::size_t MapNodeOverhead = 4 * sizeof(void*);
+
+/**
+* @brief Bytes held by a book, by structure. Flat containers count the capacity they have reserved, node based ones
+* are estimated from their size and MapNodeOverhead, so the figures are close but are not what the allocator reports.
+*/
+struct OrderbookMemoryUsage
+{
+	std::size_t restingOrders_{};
+	// Note(vss): the cost of one more resting order, its record in the pool, its queue entry and its slot in the id index.
+	std::size_t bytesPerOrder_{};
+
+	std::size_t orders_{};       // OrderPool, one record for every order the book has room for
+	std::size_t orderIndex_{};   // OrderIdIndex table and dense window
+	std::size_t levels_{};       // price levels of both sides, their queues, occupancy bitmaps and quantity trees
+	std::size_t expiries_{};     // ExpiryIndex
+
+	std::size_t Total() const { return orders_ + orderIndex_ + levels_ + expiries_; }
+};
\ No newline at end of file
@@ -0,0 +1,317 @@
+#include <array>
+#include <chrono>
+#include <string>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <format>
+
+#include "../Orderbook.h"
+#include "../CommandParser.h"
+#include "../LatencyHistogram.h"
+#include "../Instrumentation.h"
+#include "../Journal.h"
+#include "../PlatformFile.h"
+
+// Note(vss): Match is any Add or Modify that traded, so the matching path is reported apart from orders that only rest.
+enum class ReplayOperation
+{
+	Add,
+	Match,
+	Modify,
+	Cancel,
+	Session,
+};
+
+constexpr std::array<const char*, 5> ReplayOperationNames{ "Add", "Match", "Modify", "Cancel", "Session" };
+
+struct ReplayOptions
+{
+	std::string path_;
+	OrderbookSettings settings_{ .threading_ = OrderbookThreading::SingleWriter };
+	// Note(vss): commands applied before latencies are recorded, so cold caches and pool growth do not skew the tail.
+	std::uint64_t warmup_{};
+	// Note(vss): where the book's own instrumentation is written, only filled in builds with ORDERBOOK_INSTRUMENTATION.
+	std::string instrumentationPath_;
+};
+
+/**
+* @brief Streams a command file through one Orderbook, timing every command on its own.
+* Accepts the text format of OrderbookTests/TestFolder or a binary journal written by a journaling book.
+*/
+class ReplayDriver
+{
+public:
+
+	explicit ReplayDriver(const ReplayOptions& options) :
+		orderbook_{ options.settings_ },
+		warmup_{ options.warmup_ }
+	{}
+
+	void Run(const std::string& path)
+	{
+		const auto start = Clock::now();
+
+		if (IsJournal(path))
+		{
+			JournalReader{ path }.ForEachCommand([this](const OrderCommand& command) { Apply(command); });
+		}
+		else
+		{
+			ReplayText(path);
+		}
+
+		wallNanoseconds_ = ToNanoseconds(Clock::now() - start);
+	}
+
+	void Report(std::ostream& output) const
+	{
+		const auto commands = commands_ - std::min(commands_, warmup_);
+		const auto seconds = static_cast<double>(engineNanoseconds_) / 1e9;
+
+		output << std::format("commands {}, warmup {}, trades {}, resting orders {}\n", commands_, std::min(commands_, warmup_), trades_, orderbook_.Size());
+		output << std::format("engine {:.3f} s, {:.0f} commands/s, wall {:.3f} s including parsing\n",
+			seconds, seconds == 0.0 ? 0.0 : static_cast<double>(commands) / seconds, static_cast<double>(wallNanoseconds_) / 1e9);
+		const auto memory = orderbook_.MemoryUsage();
+		output << std::format("memory {} bytes, orders {}, index {}, levels {}, expiries {}, {} bytes per resting order\n",
+			memory.Total(), memory.orders_, memory.orderIndex_, memory.levels_, memory.expiries_, memory.bytesPerOrder_);
+		output << std::format("{:<8}{:>12}{:>10}{:>10}{:>10}{:>10}{:>12}  (ns)\n", "op", "count", "mean", "p50", "p99", "p99.9", "max");
+
+		LatencyHistogram all;
+		for (std::size_t index = 0; index < histograms_.size(); ++index)
+		{
+			WriteRow(output, ReplayOperationNames[index], histograms_[index]);
+			all.Merge(histograms_[index]);
+		}
+		WriteRow(output, "All", all);
+	}
+
+	// Note(vss): false if the file stated an expected result and the book does not match it.
+	bool CheckResult(std::ostream& output) const
+	{
+		if (!hasResult_)
+		{
+			return true;
+		}
+
+		const auto infos = orderbook_.GetOrderInfos();
+		const bool matches = orderbook_.Size() == result_.allCount_ && infos.GetBids().size() == result_.bidCount_ && infos.GetAsks().size() == result_.askCount_;
+		output << std::format("result {}: expected {} {} {}, got {} {} {}\n", matches ? "ok" : "MISMATCH",
+			result_.allCount_, result_.bidCount_, result_.askCount_, orderbook_.Size(), infos.GetBids().size(), infos.GetAsks().size());
+		return matches;
+	}
+
+private:
+
+	using Clock = std::chrono::steady_clock;
+
+	Orderbook orderbook_;
+	std::uint64_t warmup_;
+	std::array<LatencyHistogram, ReplayOperationNames.size()> histograms_;
+	std::uint64_t commands_{};
+	std::uint64_t trades_{};
+	std::uint64_t engineNanoseconds_{};
+	std::uint64_t wallNanoseconds_{};
+	ScenarioResult result_;
+	bool hasResult_{ false };
+
+	static std::uint64_t ToNanoseconds(Clock::duration duration)
+	{
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+	}
+
+	static bool IsJournal(const std::string& path)
+	{
+		const MappedFile file{ path };
+		const auto data = file.GetData();
+		std::uint32_t magic{};
+		if (data.size() < sizeof(magic))
+		{
+			return false;
+		}
+
+		std::memcpy(&magic, data.data(), sizeof(magic));
+		return magic == JournalHeader::Magic;
+	}
+
+	void ReplayText(const std::string& path)
+	{
+		const MappedFile file{ path };
+		const auto data = file.GetData();
+		const auto text = std::string_view{ reinterpret_cast<const char*>(data.data()), data.size() };
+
+		OrderCommand command;
+		std::size_t lineNumber{};
+		for (std::size_t start = 0; start < text.size();)
+		{
+			const auto end = std::min(text.find('\n', start), text.size());
+			const auto line = text.substr(start, end - start);
+			start = end + 1;
+			++lineNumber;
+
+			if (line.find_first_not_of(" \t\r") == std::string_view::npos)
+			{
+				continue;
+			}
+
+			if (CommandParser::TryParseCommand(line, command))
+			{
+				Apply(command);
+			}
+			else if (CommandParser::TryParseResult(line, result_))
+			{
+				hasResult_ = true;
+			}
+			else
+			{
+				throw std::logic_error(std::format("Invalid command on line {}: {}", lineNumber, line));
+			}
+		}
+	}
+
+	void Apply(const OrderCommand& command)
+	{
+		std::uint64_t trades{};
+
+		const auto start = Clock::now();
+		orderbook_.ApplyCommand(command, [&trades](const Trade&) { ++trades; });
+		const auto elapsed = ToNanoseconds(Clock::now() - start);
+
+		trades_ += trades;
+		if (commands_++ < warmup_)
+		{
+			if (commands_ == warmup_)
+			{
+				Instrumentation::Get().Reset();
+			}
+			return;
+		}
+
+		engineNanoseconds_ += elapsed;
+		histograms_[static_cast<std::size_t>(Classify(command.type_, trades))].Record(elapsed);
+	}
+
+	static ReplayOperation Classify(CommandType type, std::uint64_t trades)
+	{
+		if (type == CommandType::Cancel)
+		{
+			return ReplayOperation::Cancel;
+		}
+		if (type == CommandType::BeginAuction || type == CommandType::Uncross)
+		{
+			return ReplayOperation::Session;
+		}
+		if (trades != 0)
+		{
+			return ReplayOperation::Match;
+		}
+		return type == CommandType::Add ? ReplayOperation::Add : ReplayOperation::Modify;
+	}
+
+	static void WriteRow(std::ostream& output, const char* name, const LatencyHistogram& histogram)
+	{
+		output << std::format("{:<8}{:>12}{:>10.0f}{:>10}{:>10}{:>10}{:>12}\n", name, histogram.GetCount(), histogram.GetMean(),
+			histogram.GetPercentile(50.0), histogram.GetPercentile(99.0), histogram.GetPercentile(99.9), histogram.GetMax());
+	}
+};
+
+static void PrintUsage()
+{
+	std::cerr << "usage: OrderbookReplay <file> [--capacity <orders>] [--ladder <tick> <min> <max>] [--dense-ids <first> <count>] [--warmup <commands>] [--synchronized] [--instrumentation <path>]\n"
+		"  file is either a text command file in the OrderbookTests/TestFolder format or a binary journal.\n"
+		"  Exits with 2 if the file's closing R line does not match the replayed book.\n"
+		"  --instrumentation writes the book's per phase histograms, they are only filled in builds with ORDERBOOK_INSTRUMENTATION defined.\n";
+}
+
+static ReplayOptions ParseOptions(int argc, char* argv[])
+{
+	ReplayOptions options;
+
+	auto NextNumber = [&](int& index) -> std::int64_t
+		{
+			if (++index >= argc)
+			{
+				throw std::logic_error(std::format("Missing value after ({}).", argv[index - 1]));
+			}
+			return std::stoll(argv[index]);
+		};
+
+	for (int index = 1; index < argc; ++index)
+	{
+		const std::string_view argument{ argv[index] };
+		if (argument == "--capacity")
+		{
+			options.settings_.orderCapacity_ = static_cast<std::size_t>(NextNumber(index));
+		}
+		else if (argument == "--ladder")
+		{
+			LadderSettings ladder;
+			ladder.tickSize_ = static_cast<Price>(NextNumber(index));
+			ladder.minPrice_ = static_cast<Price>(NextNumber(index));
+			ladder.maxPrice_ = static_cast<Price>(NextNumber(index));
+			options.settings_.ladder_ = ladder;
+		}
+		else if (argument == "--dense-ids")
+		{
+			DenseOrderIdSettings denseOrderIds;
+			denseOrderIds.firstId_ = static_cast<OrderId>(NextNumber(index));
+			denseOrderIds.count_ = static_cast<std::size_t>(NextNumber(index));
+			options.settings_.denseOrderIds_ = denseOrderIds;
+		}
+		else if (argument == "--warmup")
+		{
+			options.warmup_ = static_cast<std::uint64_t>(NextNumber(index));
+		}
+		else if (argument == "--synchronized")
+		{
+			options.settings_.threading_ = OrderbookThreading::Synchronized;
+		}
+		else if (argument == "--instrumentation")
+		{
+			if (++index >= argc)
+			{
+				throw std::logic_error("Missing path after (--instrumentation).");
+			}
+			options.instrumentationPath_ = argv[index];
+		}
+		else if (options.path_.empty() && !argument.starts_with("--"))
+		{
+			options.path_ = argument;
+		}
+		else
+		{
+			throw std::logic_error(std::format("Unknown argument ({}).", argument));
+		}
+	}
+
+	if (options.path_.empty())
+	{
+		throw std::logic_error("No input file given.");
+	}
+
+	return options;
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		const auto options = ParseOptions(argc, argv);
+
+		ReplayDriver driver{ options };
+		driver.Run(options.path_);
+		driver.Report(std::cout);
+		if (!options.instrumentationPath_.empty())
+		{
+			Instrumentation::Get().Write(options.instrumentationPath_);
+		}
+
+		return driver.CheckResult(std::cout) ? 0 : 2;
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << exception.what() << '\n';
+		PrintUsage();
+		return 1;
+	}
+}
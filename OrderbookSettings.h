@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <optional>
+
+#include "Aliases.h"
+
+/**
+* @brief Price band served by the dense, tick indexed ladder. Prices inside [minPrice_, maxPrice_] that sit on
+* a tick boundary are stored in a contiguous array, everything else falls back to the sparse map.
+*/
+struct LadderSettings
+{
+	Price tickSize_{ 1 };
+	Price minPrice_{};
+	Price maxPrice_{};
+};
+
+/**
+* @brief Window of dense, exchange assigned order ids. Ids in [firstId_, firstId_ + count_) are looked up by direct indexing,
+* which costs count_ handles of memory up front, any other id still works through the hash table.
+*/
+struct DenseOrderIdSettings
+{
+	OrderId firstId_{};
+	std::size_t count_{};
+};
+
+/**
+* @brief Synchronized books guard every call with a mutex and expire their own GoodForDay and GoodTillDate orders.
+* SingleWriter books take no locks and start no threads, they must only ever be touched by the one thread that owns them.
+*/
+enum class OrderbookThreading
+{
+	Synchronized,
+	SingleWriter,
+};
+
+/**
+* @brief When the journal syncs records to the disk. Every policy writes a command's record to the file before the command is applied,
+* so a crash of the process never loses an applied command. The policies differ in how many applied commands a power loss can take with it.
+*/
+enum class JournalSyncPolicy
+{
+	// Note(vss): records are never synced, the OS decides when they reach the disk.
+	None,
+	// Note(vss): every record is synced before its command is applied, nothing accepted is ever lost.
+	EveryCommand,
+	// Note(vss): records are synced once batchSize_ of them are written and on FlushJournal, a power loss loses fewer than batchSize_.
+	Batched,
+};
+
+struct JournalSettings
+{
+	std::string path_;
+	JournalSyncPolicy syncPolicy_{ JournalSyncPolicy::Batched };
+	std::size_t batchSize_{ 256 };
+};
+
+/**
+* @brief Construction time settings of an Orderbook.
+*/
+struct OrderbookSettings
+{
+	// Note(vss): number of resting orders the pool and the order index are sized for up front.
+	std::size_t orderCapacity_{};
+	std::optional<LadderSettings> ladder_{};
+	std::optional<DenseOrderIdSettings> denseOrderIds_{};
+	OrderbookThreading threading_{ OrderbookThreading::Synchronized };
+	// Note(vss): when set, every inbound command is appended to this write ahead journal, see Journal.h.
+	std::optional<JournalSettings> journal_{};
+};
@@ -7,4 +7,6 @@
 #include "gtest/gtest.h"
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <filesystem>
+#include <unordered_set>
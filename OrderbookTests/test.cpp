@@ -1,6 +1,13 @@
 #include "pch.h"
 
 #include "../Orderbook.cpp"
+#include "../MatchingEngine.h"
+#include "../Exchange.h"
+#include "../CommandParser.h"
+#include "../LatencyHistogram.h"
+#include "../Instrumentation.h"
+#include "../OrderIdIndex.h"
+#include "../OrderFlowGenerator.h"
 
 namespace googletest = ::testing;
 
@@ -300,9 +307,1196 @@ TEST_P(OrderbookTestsFixture, OrderbookTestSuite)
 INSTANTIATE_TEST_CASE_P(Tests, OrderbookTestsFixture, googletest::ValuesIn({
 	"Match_GoodTillCancel.txt",
 	"Match_FillAndKill.txt",
+	"Match_FillAndKill_Partial.txt",
 	"Match_FillOrKill_Hit.txt",
 	"Match_FillOrKill_Miss.txt",
 	"Cancel_Success.txt",
 	"Modify_Side.txt",
 	"Match_Market.txt"
-	}));
\ No newline at end of file
+	}));
+
+TEST(OrderPoolTests, ReusesReleasedHandlesAndKeepsFifoOrder)
+{
+	OrderPool pool{ 8 };
+	OrderQueue queue;
+	const auto capacity = pool.Capacity();
+
+	const auto first = pool.Allocate(Order{ OrderType::GoodTillCancel, 1, Side::Buy, 100, 10 });
+	const auto second = pool.Allocate(Order{ OrderType::GoodTillCancel, 2, Side::Buy, 100, 10 });
+	const auto third = pool.Allocate(Order{ OrderType::GoodTillCancel, 3, Side::Buy, 100, 10 });
+	pool.PushBack(queue, first, 10);
+	pool.PushBack(queue, second, 10);
+	pool.PushBack(queue, third, 10);
+
+	pool.Erase(queue, second);
+	pool.Release(second);
+	ASSERT_EQ(pool.Get(queue.Front().handle_).orderId_, 1);
+	pool.PopFront(queue);
+	ASSERT_EQ(pool.Get(queue.Front().handle_).orderId_, 3);
+	ASSERT_EQ(queue.Size(), 1);
+
+	const auto reused = pool.Allocate(Order{ OrderType::GoodTillCancel, 4, Side::Buy, 100, 10 });
+	ASSERT_EQ(reused, second);
+	ASSERT_EQ(pool.Size(), 3);
+	ASSERT_EQ(pool.Capacity(), capacity);
+}
+
+TEST(OrderPoolTests, TombstonedCancelsKeepFifoOrderThroughCompaction)
+{
+	OrderPool pool{ 256 };
+	OrderQueue queue;
+
+	std::vector<OrderHandle> handles;
+	for (OrderId orderId = 0; orderId < 200; ++orderId)
+	{
+		handles.push_back(pool.Allocate(Order{ OrderType::GoodTillCancel, orderId, Side::Sell, 100, 1 }));
+		pool.PushBack(queue, handles.back(), 1);
+	}
+
+	// Note(vss): cancelling two of every three orders from the middle leaves enough tombstones to force compactions along the way.
+	for (OrderId orderId = 0; orderId < 200; ++orderId)
+	{
+		if (orderId % 3 != 0)
+		{
+			pool.Erase(queue, handles[orderId]);
+		}
+	}
+	pool.PopFront(queue);
+	pool.PushBack(queue, pool.Allocate(Order{ OrderType::GoodTillCancel, 1000, Side::Sell, 100, 1 }), 1);
+	pool.Erase(queue, handles[99]);
+
+	OrderIds remaining;
+	queue.ForEach([&](OrderHandle handle, Quantity) { remaining.push_back(pool.Get(handle).orderId_); });
+
+	OrderIds expected;
+	for (OrderId orderId = 3; orderId < 200; orderId += 3)
+	{
+		if (orderId != 99)
+		{
+			expected.push_back(orderId);
+		}
+	}
+	expected.push_back(1000);
+	ASSERT_EQ(remaining, expected);
+	ASSERT_EQ(queue.Size(), expected.size());
+	ASSERT_EQ(pool.Get(queue.Front().handle_).orderId_, 3);
+}
+
+TEST(OrderbookLadderTests, MixesLadderAndSparseLevelsInPriceOrder)
+{
+	Orderbook orderbook{ OrderbookSettings{ .ladder_ = LadderSettings{ 2, 100, 110 } } };
+
+	// Note(vss): 104 and 100 are on the ladder, 105 is off tick and 120 / 90 are outside the band.
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 1, Side::Buy, 104, 10 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 2, Side::Buy, 90, 10 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 3, Side::Buy, 100, 10 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 4, Side::Sell, 120, 10 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 5, Side::Sell, 105, 10 });
+
+	auto infos = orderbook.GetOrderInfos();
+	ASSERT_EQ(infos.GetBids().size(), 3);
+	ASSERT_EQ(infos.GetBids()[0].price_, 104);
+	ASSERT_EQ(infos.GetBids()[1].price_, 100);
+	ASSERT_EQ(infos.GetBids()[2].price_, 90);
+	ASSERT_EQ(infos.GetAsks()[0].price_, 105);
+	ASSERT_EQ(infos.GetAsks()[1].price_, 120);
+
+	const auto trades = orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 6, Side::Sell, 90, 25 });
+	ASSERT_EQ(trades.size(), 3);
+	ASSERT_EQ(trades[0].GetBidTrade().orderId_, 1);
+	ASSERT_EQ(trades[1].GetBidTrade().orderId_, 3);
+	ASSERT_EQ(trades[2].GetBidTrade().orderId_, 2);
+	ASSERT_EQ(trades[2].GetAskTrade().quantity_, 5);
+
+	infos = orderbook.GetOrderInfos();
+	ASSERT_EQ(infos.GetBids().size(), 1);
+	ASSERT_EQ(infos.GetBids()[0].price_, 90);
+	ASSERT_EQ(infos.GetAsks()[0].price_, 105);
+}
+
+template <typename Engine>
+std::vector<EngineEvent> PollEvents(Engine& engine, std::size_t processedCount)
+{
+	std::vector<EngineEvent> events;
+	EngineEvent event;
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+	while (processedCount != 0 && std::chrono::steady_clock::now() < deadline)
+	{
+		if (!engine.TryPollEvent(event))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		events.push_back(event);
+		if (event.type_ == EngineEventType::CommandProcessed)
+		{
+			--processedCount;
+		}
+	}
+
+	return events;
+}
+
+TEST(MatchingEngineTests, PublishesTradesInCommandOrder)
+{
+	MatchingEngine<SpscRingBuffer<OrderCommand, 1024>, BlockingWaitStrategy, 1024> engine;
+
+	engine.Submit(OrderCommand::Add(Order{ OrderType::GoodTillCancel, 1, Side::Buy, 100, 10 }));
+	engine.Submit(OrderCommand::Add(Order{ OrderType::GoodTillCancel, 2, Side::Sell, 100, 4 }));
+	engine.Submit(OrderCommand::Add(Order{ OrderType::GoodTillCancel, 3, Side::Sell, 100, 6 }));
+
+	const auto events = PollEvents(engine, 3);
+	ASSERT_EQ(events.size(), 5);
+	ASSERT_EQ(events[0].type_, EngineEventType::CommandProcessed);
+	ASSERT_EQ(events[1].type_, EngineEventType::Trade);
+	ASSERT_EQ(events[1].sequence_, 2);
+	ASSERT_EQ(events[1].askTrade_.orderId_, 2);
+	ASSERT_EQ(events[1].bidTrade_.quantity_, 4);
+	ASSERT_EQ(events[3].type_, EngineEventType::Trade);
+	ASSERT_EQ(events[3].sequence_, 3);
+	ASSERT_EQ(events[3].askTrade_.orderId_, 3);
+	ASSERT_EQ(events[4].sequence_, 3);
+}
+
+TEST(MatchingEngineTests, AcceptsCommandsFromManyProducers)
+{
+	MatchingEngine<MpscRingBuffer<OrderCommand, 1024>, BusySpinWaitStrategy> engine;
+	constexpr OrderId OrdersPerProducer = 1000;
+	constexpr OrderId ProducerCount = 4;
+
+	{
+		std::vector<std::jthread> producers;
+		for (OrderId producer = 0; producer < ProducerCount; ++producer)
+		{
+			producers.emplace_back([&engine, producer]
+				{
+					for (OrderId index = 1; index <= OrdersPerProducer; ++index)
+					{
+						engine.Submit(OrderCommand::Add(Order{ OrderType::GoodTillCancel, producer * OrdersPerProducer + index, Side::Buy, 100, 1 }));
+					}
+				});
+		}
+	}
+
+	engine.Submit(OrderCommand::Add(Order{ OrderType::GoodTillCancel, 0, Side::Sell, 100, OrdersPerProducer * ProducerCount }));
+
+	const auto events = PollEvents(engine, OrdersPerProducer * ProducerCount + 1);
+	const auto trades = std::count_if(events.begin(), events.end(), [](const EngineEvent& event) { return event.type_ == EngineEventType::Trade; });
+	ASSERT_EQ(events.size(), OrdersPerProducer * ProducerCount * 2 + 1);
+	ASSERT_EQ(trades, OrdersPerProducer * ProducerCount);
+}
+
+TEST(MatchingEngineTests, ExpiresOrdersWhenTheyFallDue)
+{
+	MatchingEngine<SpscRingBuffer<OrderCommand, 1024>, BlockingWaitStrategy, 1024> engine;
+	const auto now = GetCurrentTimestamp();
+
+	// Note(vss): the timer sleeps until the first order's expiry an hour away, the second one has to bring it forward.
+	engine.Submit(OrderCommand::Add(Order{ OrderType::GoodTillDate, 1, Side::Buy, 90, 10, now + 3'600'000'000'000 }));
+	engine.Submit(OrderCommand::Add(Order{ OrderType::GoodTillDate, 2, Side::Buy, 91, 10, now + 50'000'000 }));
+	ASSERT_EQ(PollEvents(engine, 2).size(), 2);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds{ 250 });
+	engine.Submit(OrderCommand::Add(Order{ OrderType::FillAndKill, 3, Side::Sell, 90, 10 }));
+	const auto events = PollEvents(engine, 1);
+	ASSERT_EQ(events.size(), 2);
+	ASSERT_EQ(events[0].type_, EngineEventType::Trade);
+	ASSERT_EQ(events[0].bidTrade_.orderId_, 1);
+}
+
+TEST(ExchangeTests, RoutesCommandsToIndependentBooks)
+{
+	constexpr SymbolId SymbolCount = 8;
+	Exchange<BlockingWaitStrategy, 1024, 1024> exchange{ ExchangeSettings{ .workerCount_ = 3 } };
+	for (SymbolId symbol = 0; symbol < SymbolCount; ++symbol)
+	{
+		exchange.AddSymbol(symbol);
+	}
+	exchange.Start();
+
+	// Note(vss): same order ids in every book, the books must not see each other's orders.
+	for (SymbolId symbol = 0; symbol < SymbolCount; ++symbol)
+	{
+		exchange.Submit(symbol, OrderCommand::Add(Order{ OrderType::GoodTillCancel, 1, Side::Buy, 100, 10 }));
+		exchange.Submit(symbol, OrderCommand::Add(Order{ OrderType::GoodTillCancel, 2, Side::Sell, 100, static_cast<Quantity>(symbol + 1) }));
+	}
+
+	std::vector<Quantity> traded(SymbolCount);
+	std::vector<std::uint64_t> lastSequence(SymbolCount);
+	std::size_t processed{};
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (processed < SymbolCount * 2 && std::chrono::steady_clock::now() < deadline)
+	{
+		exchange.PollEvents([&](const ExchangeEvent& event)
+			{
+				ASSERT_GE(event.event_.sequence_, lastSequence[event.symbol_]);
+				lastSequence[event.symbol_] = event.event_.sequence_;
+
+				if (event.event_.type_ == EngineEventType::Trade)
+				{
+					traded[event.symbol_] += event.event_.askTrade_.quantity_;
+				}
+				else
+				{
+					++processed;
+				}
+			});
+	}
+
+	ASSERT_EQ(processed, SymbolCount * 2);
+	for (SymbolId symbol = 0; symbol < SymbolCount; ++symbol)
+	{
+		ASSERT_EQ(traded[symbol], symbol + 1);
+	}
+	ASSERT_THROW(exchange.Submit(SymbolCount, OrderCommand::Cancel(1)), std::logic_error);
+}
+
+TEST(ExchangeTests, RejectsACoreItCannotPinTo)
+{
+	Exchange<BlockingWaitStrategy, 1024, 1024> exchange{ ExchangeSettings{ .workerCount_ = 1, .cores_ = { 1'000'000 } } };
+	exchange.AddSymbol(0);
+	ASSERT_THROW(exchange.Start(), std::logic_error);
+}
+
+TEST(ExchangeTests, ExpiresOnlyTheBooksThatFallDue)
+{
+	constexpr SymbolId SymbolCount = 4;
+	Exchange<BlockingWaitStrategy, 1024, 1024> exchange{ ExchangeSettings{ .workerCount_ = 2 } };
+	for (SymbolId symbol = 0; symbol < SymbolCount; ++symbol)
+	{
+		exchange.AddSymbol(symbol);
+	}
+	exchange.Start();
+
+	// Note(vss): every worker first schedules the hour away expiry, then odd symbols bring it forward for their worker's books.
+	const auto now = GetCurrentTimestamp();
+	for (SymbolId symbol = 0; symbol < SymbolCount; ++symbol)
+	{
+		exchange.Submit(symbol, OrderCommand::Add(Order{ OrderType::GoodTillDate, 1, Side::Buy, 90, 10, now + 3'600'000'000'000 }));
+	}
+	for (SymbolId symbol = 0; symbol < SymbolCount; ++symbol)
+	{
+		const auto expiry = symbol % 2 == 0 ? now + 3'600'000'000'000 : now + 50'000'000;
+		exchange.Submit(symbol, OrderCommand::Add(Order{ OrderType::GoodTillDate, 2, Side::Buy, 91, 10, expiry }));
+	}
+
+	std::this_thread::sleep_for(std::chrono::milliseconds{ 250 });
+	for (SymbolId symbol = 0; symbol < SymbolCount; ++symbol)
+	{
+		exchange.Submit(symbol, OrderCommand::Add(Order{ OrderType::FillAndKill, 3, Side::Sell, 90, 10 }));
+	}
+
+	std::vector<OrderId> matched(SymbolCount);
+	std::size_t processed{};
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (processed < SymbolCount * 3 && std::chrono::steady_clock::now() < deadline)
+	{
+		exchange.PollEvents([&](const ExchangeEvent& event)
+			{
+				if (event.event_.type_ == EngineEventType::Trade)
+				{
+					matched[event.symbol_] = event.event_.bidTrade_.orderId_;
+				}
+				else
+				{
+					++processed;
+				}
+			});
+	}
+
+	ASSERT_EQ(processed, SymbolCount * 3);
+	for (SymbolId symbol = 0; symbol < SymbolCount; ++symbol)
+	{
+		ASSERT_EQ(matched[symbol], symbol % 2 == 0 ? 2 : 1);
+	}
+}
+
+TEST(TradeSinkTests, StreamsTradesIntoCallerBuffer)
+{
+	Orderbook orderbook;
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 1, Side::Buy, 101, 5 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 2, Side::Buy, 100, 5 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 3, Side::Buy, 99, 5 });
+
+	std::array<Trade, 2> buffer;
+	TradeSpanSink sink{ buffer };
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 4, Side::Sell, 99, 15 }, sink);
+
+	ASSERT_EQ(sink.GetTrades().size(), 2);
+	ASSERT_EQ(sink.GetDropped(), 1);
+	ASSERT_EQ(sink.GetTrades()[0].GetBidTrade().orderId_, 1);
+	ASSERT_EQ(sink.GetTrades()[1].GetBidTrade().orderId_, 2);
+	ASSERT_EQ(orderbook.Size(), 0);
+
+	Quantity traded{};
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 5, Side::Buy, 100, 7 });
+	orderbook.ModifyOrder(OrderModify{ 5, Side::Sell, 100, 7 }, [&traded](const Trade& trade) { traded += trade.GetAskTrade().quantity_; });
+	ASSERT_EQ(traded, 0);
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 6, Side::Buy, 100, 3 }, [&traded](const Trade& trade) { traded += trade.GetAskTrade().quantity_; });
+	ASSERT_EQ(traded, 3);
+}
+
+TEST(MarketDataTests, PublishesOneBatchPerCommand)
+{
+	Orderbook orderbook;
+	std::vector<std::uint64_t> sequences;
+	std::vector<std::vector<LevelUpdate>> batches;
+	orderbook.SetMarketDataListener([&](const MarketDataBatch& batch)
+		{
+			sequences.push_back(batch.sequence_);
+			batches.emplace_back(batch.updates_.begin(), batch.updates_.end());
+		});
+
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 1, Side::Buy, 100, 10 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 2, Side::Buy, 100, 5 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 3, Side::Sell, 100, 12 });
+	orderbook.CancelOrder(42);
+
+	ASSERT_EQ(sequences, (std::vector<std::uint64_t>{ 1, 2, 3 }));
+	ASSERT_EQ(batches[1].size(), 1);
+	ASSERT_EQ(batches[1][0].quantity_, 15);
+	ASSERT_EQ(batches[1][0].count_, 2);
+
+	// Note(vss): the sell fills without ever resting and touches the bid level twice, which is reported once.
+	const auto& sweep = batches[2];
+	ASSERT_EQ(sweep.size(), 1);
+	ASSERT_EQ(sweep[0].side_, Side::Buy);
+	ASSERT_EQ(sweep[0].quantity_, 3);
+	ASSERT_EQ(sweep[0].count_, 1);
+
+	const auto snapshot = orderbook.GetMarketDataSnapshot();
+	ASSERT_EQ(snapshot.sequence_, 3);
+	ASSERT_EQ(snapshot.levels_.size(), 1);
+	ASSERT_EQ(snapshot.levels_[0].price_, 100);
+	ASSERT_EQ(snapshot.levels_[0].quantity_, 3);
+}
+
+TEST(DepthTests, WritesBestLevelsIntoCallerBuffers)
+{
+	Orderbook orderbook;
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 1, Side::Buy, 99, 10 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 2, Side::Buy, 100, 5 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 3, Side::Buy, 100, 7 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 4, Side::Buy, 98, 1 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 5, Side::Sell, 101, 4 });
+
+	std::array<LevelInfo, 2> bids{ };
+	std::array<LevelInfo, 2> asks{ };
+	const auto [bidCount, askCount] = orderbook.GetDepth(bids, asks);
+
+	ASSERT_EQ(bidCount, 2);
+	ASSERT_EQ(askCount, 1);
+	ASSERT_EQ(bids[0].price_, 100);
+	ASSERT_EQ(bids[0].quantity_, 12);
+	ASSERT_EQ(bids[1].price_, 99);
+	ASSERT_EQ(bids[1].quantity_, 10);
+	ASSERT_EQ(asks[0].price_, 101);
+	ASSERT_EQ(asks[0].quantity_, 4);
+}
+
+TEST(TopOfBookTests, ReadersSeeConsistentBooksWithoutLocking)
+{
+	Orderbook orderbook;
+	std::atomic<bool> done{ false };
+	std::atomic<std::size_t> inconsistent{ 0 };
+
+	std::jthread reader{ [&]
+		{
+			while (!done.load(std::memory_order_acquire))
+			{
+				const auto topOfBook = orderbook.GetTopOfBook();
+				for (std::uint32_t index = 1; index < topOfBook.bidCount_; ++index)
+				{
+					if (topOfBook.bids_[index - 1].price_ <= topOfBook.bids_[index].price_)
+					{
+						inconsistent.fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+				if (topOfBook.bidCount_ != 0 && topOfBook.askCount_ != 0 && topOfBook.bids_[0].price_ >= topOfBook.asks_[0].price_)
+				{
+					inconsistent.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+		} };
+
+	for (OrderId orderId = 1; orderId <= 2000; ++orderId)
+	{
+		const auto side = orderId % 2 == 0 ? Side::Buy : Side::Sell;
+		const auto price = static_cast<Price>(side == Side::Buy ? 90 + orderId % 11 : 95 + orderId % 13);
+		orderbook.AddOrder(Order{ OrderType::GoodTillCancel, orderId, side, price, static_cast<Quantity>(1 + orderId % 7) });
+	}
+
+	done.store(true, std::memory_order_release);
+	reader.join();
+
+	ASSERT_EQ(inconsistent.load(), 0);
+
+	const auto topOfBook = orderbook.GetTopOfBook();
+	const auto infos = orderbook.GetOrderInfos();
+	ASSERT_EQ(topOfBook.bidCount_, std::min(infos.GetBids().size(), TopOfBook::Depth));
+	ASSERT_EQ(topOfBook.askCount_, std::min(infos.GetAsks().size(), TopOfBook::Depth));
+	ASSERT_EQ(topOfBook.bids_[0].price_, infos.GetBids()[0].price_);
+	ASSERT_EQ(topOfBook.bids_[0].quantity_, infos.GetBids()[0].quantity_);
+}
+
+TEST(JournalTests, ReplayRebuildsBookAndTrades)
+{
+	const auto path = (std::filesystem::temp_directory_path() / "OrderbookJournalTest.bin").string();
+	std::filesystem::remove(path);
+
+	const std::vector<OrderCommand> commands
+	{
+		OrderCommand::Add(Order{ OrderType::GoodTillCancel, 1, Side::Buy, 100, 10 }),
+		OrderCommand::Add(Order{ OrderType::GoodTillCancel, 2, Side::Buy, 101, 5 }),
+		OrderCommand::Add(Order{ OrderType::FillAndKill, 3, Side::Sell, 100, 8 }),
+		OrderCommand::Modify(OrderModify{ 1, Side::Buy, 99, 4 }),
+		OrderCommand::Add(Order{ OrderType::GoodTillCancel, 4, Side::Sell, 99, 1 }),
+		OrderCommand::Cancel(2),
+	};
+
+	Trades liveTrades;
+	std::size_t liveSize{};
+	{
+		Orderbook orderbook{ OrderbookSettings{ .journal_ = JournalSettings{ path, JournalSyncPolicy::Batched, 4 } } };
+		for (const auto& command : commands)
+		{
+			const auto trades = orderbook.ApplyCommand(command);
+			liveTrades.insert(liveTrades.end(), trades.begin(), trades.end());
+		}
+		liveSize = orderbook.Size();
+
+		// Note(vss): only the sync waits for a full batch, every applied command is already in the file.
+		ASSERT_EQ(std::filesystem::file_size(path), sizeof(JournalHeader) + commands.size() * sizeof(JournalRecord));
+	}
+
+	// Note(vss): a record torn by a crash must be dropped, and appending must resume right after the last intact one.
+	{
+		std::ofstream journal{ path, std::ios::binary | std::ios::app };
+		journal.write("torn", 4);
+	}
+	{
+		Orderbook orderbook{ OrderbookSettings{ .journal_ = JournalSettings{ path, JournalSyncPolicy::EveryCommand } } };
+		ASSERT_EQ(orderbook.ReplayJournal(path), commands.size());
+		orderbook.CancelOrder(1);
+	}
+
+	Orderbook orderbook;
+	Trades replayedTrades;
+	ASSERT_EQ(orderbook.ReplayJournal(path, 0, [&replayedTrades](const Trade& trade) { replayedTrades.push_back(trade); }), commands.size() + 1);
+
+	ASSERT_EQ(liveSize, 1);
+	ASSERT_EQ(orderbook.Size(), 0);
+	ASSERT_EQ(replayedTrades.size(), liveTrades.size());
+	for (std::size_t index = 0; index < liveTrades.size(); ++index)
+	{
+		ASSERT_EQ(replayedTrades[index].GetBidTrade().orderId_, liveTrades[index].GetBidTrade().orderId_);
+		ASSERT_EQ(replayedTrades[index].GetAskTrade().orderId_, liveTrades[index].GetAskTrade().orderId_);
+		ASSERT_EQ(replayedTrades[index].GetBidTrade().quantity_, liveTrades[index].GetBidTrade().quantity_);
+	}
+
+	std::filesystem::remove(path);
+}
+
+TEST(JournalTests, ReopeningDropsAPartlyWrittenRecord)
+{
+	const auto path = (std::filesystem::temp_directory_path() / "OrderbookJournalTornTest.bin").string();
+	std::filesystem::remove(path);
+
+	{
+		JournalWriter writer{ JournalSettings{ path, JournalSyncPolicy::EveryCommand } };
+		for (OrderId orderId = 1; orderId <= 3; ++orderId)
+		{
+			writer.Append(OrderCommand::Cancel(orderId));
+		}
+	}
+
+	// Note(vss): the first half of a fourth record, as a crash in the middle of a write leaves it.
+	{
+		const auto record = JournalRecord::FromCommand(4, OrderCommand::Cancel(4));
+		std::ofstream journal{ path, std::ios::binary | std::ios::app };
+		journal.write(reinterpret_cast<const char*>(&record), sizeof(record) / 2);
+	}
+	ASSERT_EQ(std::filesystem::file_size(path), sizeof(JournalHeader) + 3 * sizeof(JournalRecord) + sizeof(JournalRecord) / 2);
+
+	{
+		JournalWriter writer{ JournalSettings{ path, JournalSyncPolicy::EveryCommand } };
+		ASSERT_EQ(writer.GetSequence(), 3);
+		ASSERT_EQ(std::filesystem::file_size(path), sizeof(JournalHeader) + 3 * sizeof(JournalRecord));
+		writer.Append(OrderCommand::Cancel(5));
+	}
+
+	std::vector<OrderId> orderIds;
+	ASSERT_EQ(JournalReader{ path }.ForEachCommand([&orderIds](const OrderCommand& command) { orderIds.push_back(command.orderId_); }), 4);
+	ASSERT_EQ(orderIds, (std::vector<OrderId>{ 1, 2, 3, 5 }));
+
+	std::filesystem::remove(path);
+}
+
+TEST(JournalTests, ReplayKeepsTheJournaledGoodForDayCutoff)
+{
+	const auto path = (std::filesystem::temp_directory_path() / "OrderbookJournalGoodForDayTest.bin").string();
+	std::filesystem::remove(path);
+
+	const auto cutoff = ToTimestamp(GetNextGoodForDayCutoff(std::chrono::system_clock::now()));
+	{
+		Orderbook orderbook{ OrderbookSettings{ .threading_ = OrderbookThreading::SingleWriter, .journal_ = JournalSettings{ path } } };
+		orderbook.AddOrder(Order{ OrderType::GoodForDay, 1, Side::Buy, 100, 10 });
+	}
+
+	Timestamp journaledExpiry{};
+	JournalReader{ path }.ForEachCommand([&journaledExpiry](const OrderCommand& command) { journaledExpiry = command.expiry_; });
+	ASSERT_EQ(journaledExpiry, cutoff);
+
+	// Note(vss): an order journaled the day before a crash, replay must keep yesterday's cutoff rather than stamp the one of the day it runs.
+	std::filesystem::remove(path);
+	constexpr Timestamp Day = 24ll * 3600 * 1'000'000'000;
+	{
+		JournalWriter writer{ JournalSettings{ path } };
+		writer.Append(OrderCommand::Add(Order{ OrderType::GoodForDay, 1, Side::Buy, 100, 10, cutoff - Day }));
+	}
+
+	for (int replay = 0; replay < 2; ++replay)
+	{
+		Orderbook orderbook{ OrderbookSettings{ .threading_ = OrderbookThreading::SingleWriter } };
+		ASSERT_EQ(orderbook.ReplayJournal(path), 1);
+		ASSERT_EQ(orderbook.Size(), 1);
+		ASSERT_EQ(orderbook.ExpireOrders(cutoff - Day - 1), 0);
+		ASSERT_EQ(orderbook.ExpireOrders(GetCurrentTimestamp()), 1);
+	}
+
+	std::filesystem::remove(path);
+}
+
+TEST(SnapshotTests, LoadKeepsQueuePriorityAndReplaysOnlyTheTail)
+{
+	const auto directory = std::filesystem::temp_directory_path();
+	const auto journalPath = (directory / "OrderbookSnapshotTest.journal").string();
+	const auto snapshotPath = (directory / "OrderbookSnapshotTest.snapshot").string();
+	std::filesystem::remove(journalPath);
+
+	std::uint64_t savedSequence{};
+	std::size_t liveSize{};
+	{
+		Orderbook orderbook{ OrderbookSettings{ .journal_ = JournalSettings{ journalPath } } };
+		orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 1, Side::Buy, 100, 10 });
+		orderbook.AddOrder(Order{ OrderType::GoodForDay, 2, Side::Buy, 100, 20 });
+		orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 3, Side::Sell, 100, 4 });
+		orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 4, Side::Sell, 105, 7 });
+		savedSequence = orderbook.SaveSnapshot(snapshotPath);
+
+		orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 5, Side::Buy, 99, 3 });
+		orderbook.CancelOrder(4);
+		liveSize = orderbook.Size();
+	}
+
+	Orderbook orderbook;
+	ASSERT_EQ(orderbook.LoadSnapshot(snapshotPath), 4);
+	ASSERT_EQ(savedSequence, 4);
+	ASSERT_EQ(orderbook.Size(), 3);
+	ASSERT_EQ(orderbook.ReplayJournal(journalPath, savedSequence), 2);
+	ASSERT_EQ(orderbook.Size(), liveSize);
+
+	const auto infos = orderbook.GetOrderInfos();
+	ASSERT_EQ(infos.GetBids().size(), 2);
+	ASSERT_EQ(infos.GetBids()[0].quantity_, 26);
+	ASSERT_TRUE(infos.GetAsks().empty());
+
+	// Note(vss): order 1 was partly filled before the snapshot and must still be first in its queue.
+	const auto trades = orderbook.AddOrder(Order{ OrderType::FillAndKill, 6, Side::Sell, 100, 8 });
+	ASSERT_EQ(trades.size(), 2);
+	ASSERT_EQ(trades[0].GetBidTrade().orderId_, 1);
+	ASSERT_EQ(trades[0].GetBidTrade().quantity_, 6);
+	ASSERT_EQ(trades[1].GetBidTrade().orderId_, 2);
+
+	std::filesystem::remove(journalPath);
+	std::filesystem::remove(snapshotPath);
+}
+
+TEST(CommandParserTests, ParsesScenarioLines)
+{
+	OrderCommand command;
+	ASSERT_TRUE(CommandParser::TryParseCommand("A S FillOrKill 101 7 42", command));
+	ASSERT_EQ(command.type_, CommandType::Add);
+	ASSERT_EQ(command.side_, Side::Sell);
+	ASSERT_EQ(command.orderType_, OrderType::FillOrKill);
+	ASSERT_EQ(command.price_, 101);
+	ASSERT_EQ(command.quantity_, 7);
+	ASSERT_EQ(command.orderId_, 42);
+
+	ASSERT_TRUE(CommandParser::TryParseCommand("M 42 B 99 3\r", command));
+	ASSERT_EQ(command.type_, CommandType::Modify);
+	ASSERT_EQ(command.side_, Side::Buy);
+	ASSERT_EQ(command.price_, 99);
+
+	ASSERT_TRUE(CommandParser::TryParseCommand("C 42", command));
+	ASSERT_EQ(command.type_, CommandType::Cancel);
+	ASSERT_EQ(command.orderId_, 42);
+
+	ASSERT_TRUE(CommandParser::TryParseCommand("P", command));
+	ASSERT_EQ(command.type_, CommandType::BeginAuction);
+	ASSERT_TRUE(CommandParser::TryParseCommand("U", command));
+	ASSERT_EQ(command.type_, CommandType::Uncross);
+
+	ASSERT_FALSE(CommandParser::TryParseCommand("A B GoodTillCancel 100 ten 1", command));
+	ASSERT_FALSE(CommandParser::TryParseCommand("R 1 0 1", command));
+
+	ScenarioResult result;
+	ASSERT_TRUE(CommandParser::TryParseResult("R 1 0 1", result));
+	ASSERT_EQ(result.allCount_, 1);
+	ASSERT_EQ(result.askCount_, 1);
+}
+
+TEST(LatencyHistogramTests, ReportsPercentilesWithinBucketPrecision)
+{
+	LatencyHistogram histogram;
+	for (std::uint64_t value = 1; value <= 100000; ++value)
+	{
+		histogram.Record(value);
+	}
+
+	ASSERT_EQ(histogram.GetCount(), 100000);
+	ASSERT_EQ(histogram.GetMax(), 100000);
+	ASSERT_NEAR(static_cast<double>(histogram.GetPercentile(50.0)), 50000.0, 50000.0 / 64);
+	ASSERT_NEAR(static_cast<double>(histogram.GetPercentile(99.0)), 99000.0, 99000.0 / 64);
+	ASSERT_NEAR(static_cast<double>(histogram.GetPercentile(99.9)), 99900.0, 99900.0 / 64);
+	ASSERT_EQ(histogram.GetPercentile(100.0), 100000);
+}
+
+TEST(OrderFlowGeneratorTests, SameSeedGivesSameStreamThatRoundTripsAsText)
+{
+	const OrderFlowSettings settings{ .seed_ = 7, .openingBurst_ = 100 };
+	OrderFlowGenerator first{ settings };
+	OrderFlowGenerator second{ settings };
+
+	std::unordered_set<OrderId> resting;
+	std::uint64_t lastTimestamp{};
+	std::uint64_t checksum{};
+	std::size_t goodTillDateCount{};
+	std::string line;
+	for (std::size_t index = 0; index < 10000; ++index)
+	{
+		const auto [command, timestamp] = first.Next();
+		checksum = checksum * 31 + command.orderId_ * 7 + static_cast<std::uint64_t>(command.price_) * 3 + command.quantity_ + timestamp;
+		const auto [other, otherTimestamp] = second.Next();
+		ASSERT_EQ(command.orderId_, other.orderId_);
+		ASSERT_EQ(command.price_, other.price_);
+		ASSERT_EQ(command.quantity_, other.quantity_);
+		ASSERT_EQ(timestamp, otherTimestamp);
+		ASSERT_GE(timestamp, lastTimestamp);
+		lastTimestamp = timestamp;
+
+		if (index < settings.openingBurst_)
+		{
+			ASSERT_EQ(command.orderType_, OrderType::GoodTillCancel);
+		}
+		if (command.type_ == CommandType::Add)
+		{
+			resting.insert(command.orderId_);
+		}
+		if (command.orderType_ == OrderType::GoodTillDate)
+		{
+			ASSERT_GT(command.expiry_, settings.expiryEpoch_);
+			++goodTillDateCount;
+		}
+		else
+		{
+			ASSERT_TRUE(resting.contains(command.orderId_));
+		}
+		if (command.type_ == CommandType::Cancel)
+		{
+			resting.erase(command.orderId_);
+		}
+
+		line.clear();
+		CommandParser::AppendCommand(line, command);
+		OrderCommand parsed;
+		ASSERT_TRUE(CommandParser::TryParseCommand(line, parsed));
+		ASSERT_EQ(parsed.type_, command.type_);
+		ASSERT_EQ(parsed.orderId_, command.orderId_);
+		ASSERT_EQ(parsed.price_, command.price_);
+		ASSERT_EQ(parsed.quantity_, command.quantity_);
+		ASSERT_EQ(parsed.expiry_, command.expiry_);
+	}
+
+	// Note(vss): the stream is pinned, a change here means files generated from the same seed no longer match older ones.
+	ASSERT_GT(goodTillDateCount, 0);
+	ASSERT_EQ(checksum, 13130361373051849719ull);
+}
+
+TEST(ExpiryTests, ExpiresDueOrdersInBoundedBatches)
+{
+	const Timestamp Expiry = GetCurrentTimestamp() + 3'600'000'000'000;
+	constexpr std::size_t ExpiringCount = 300;
+
+	Orderbook orderbook{ OrderbookSettings{ .threading_ = OrderbookThreading::SingleWriter } };
+	for (OrderId orderId = 1; orderId <= ExpiringCount; ++orderId)
+	{
+		const auto side = orderId % 2 == 0 ? Side::Buy : Side::Sell;
+		orderbook.AddOrder(Order{ OrderType::GoodTillDate, orderId, side, static_cast<Price>(side == Side::Buy ? 90 : 110), 10, Expiry });
+	}
+	orderbook.AddOrder(Order{ OrderType::GoodTillDate, 1000, Side::Buy, 95, 10, Expiry + 1'000'000'000 });
+	orderbook.AddOrder(Order{ OrderType::GoodForDay, 1001, Side::Buy, 95, 10 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 1002, Side::Buy, 95, 10 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillDate, 1003, Side::Buy, 95, 10 });
+	ASSERT_EQ(orderbook.Size(), ExpiringCount + 3);
+
+	// Note(vss): orders that leave the book before their expiry must leave the index with them, a modified order keeps its expiry.
+	orderbook.CancelOrder(2);
+	orderbook.AddOrder(Order{ OrderType::FillAndKill, 2000, Side::Buy, 110, 10 });
+	orderbook.ModifyOrder(OrderModify{ 1000, Side::Buy, 96, 5 });
+
+	ASSERT_EQ(orderbook.ExpireOrders(Expiry - 1), 0);
+	ASSERT_EQ(orderbook.ExpireOrders(Expiry + ExpiryIndex::BucketWidth), ExpiryBatchSize);
+	ASSERT_EQ(orderbook.ExpireOrders(Expiry + ExpiryIndex::BucketWidth), ExpiringCount - 2 - ExpiryBatchSize);
+	ASSERT_EQ(orderbook.ExpireOrders(Expiry + ExpiryIndex::BucketWidth), 0);
+	ASSERT_EQ(orderbook.Size(), 3);
+
+	const auto farFuture = GetCurrentTimestamp() + 7 * 24 * 3600 * 1'000'000'000ll;
+	ASSERT_EQ(orderbook.ExpireOrders(farFuture), 2);
+	ASSERT_EQ(orderbook.Size(), 1);
+	ASSERT_EQ(orderbook.GetOrderInfos().GetBids()[0].price_, 95);
+}
+
+TEST(ExpiryTests, TimerWakesForAnEarlierExpiry)
+{
+	Orderbook orderbook;
+	const auto now = GetCurrentTimestamp();
+	orderbook.AddOrder(Order{ OrderType::GoodTillDate, 1, Side::Buy, 90, 10, now + 3'600'000'000'000 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillDate, 2, Side::Buy, 91, 10, now + 50'000'000 });
+
+	// Note(vss): the timer was asleep until the first order's expiry an hour away, the second one has to bring it forward.
+	const auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds{ 5 };
+	while (orderbook.Size() != 1 && std::chrono::steady_clock::now() < giveUp)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds{ 5 });
+	}
+	ASSERT_EQ(orderbook.Size(), 1);
+	ASSERT_EQ(orderbook.GetOrderInfos().GetBids()[0].price_, 90);
+}
+
+TEST(ExpiryTests, RejectsAnOrderThatArrivesExpired)
+{
+	Orderbook orderbook{ OrderbookSettings{ .threading_ = OrderbookThreading::SingleWriter } };
+	const auto now = GetCurrentTimestamp();
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 1, Side::Sell, 100, 10 });
+
+	// Note(vss): it would cross the resting ask, but its expiry has passed so it must neither trade nor rest.
+	ASSERT_TRUE(orderbook.AddOrder(Order{ OrderType::GoodTillDate, 2, Side::Buy, 100, 10, now - 1'000'000'000 }).empty());
+	ASSERT_EQ(orderbook.Size(), 1);
+
+	const std::array commands{
+		OrderCommand::Add(Order{ OrderType::GoodTillDate, 3, Side::Buy, 100, 5, now - 1 }),
+		OrderCommand::Add(Order{ OrderType::GoodTillDate, 4, Side::Buy, 100, 5, now + 3'600'000'000'000 }),
+	};
+	CommandResults results;
+	orderbook.ApplyCommands(commands, results);
+	ASSERT_EQ(results.GetResults()[0].outcome_, CommandOutcome::Rejected);
+	ASSERT_EQ(results.GetResults()[1].outcome_, CommandOutcome::Filled);
+	ASSERT_EQ(orderbook.Size(), 1);
+	ASSERT_EQ(orderbook.GetOrderInfos().GetAsks()[0].quantity_, 5);
+}
+
+TEST(FillOrKillTests, ChecksDepthAcrossLadderAndSparseLevels)
+{
+	Orderbook orderbook{ OrderbookSettings{ .ladder_ = LadderSettings{ 1, 100, 200 } } };
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 1, Side::Sell, 99, 5 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 2, Side::Sell, 101, 5 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 3, Side::Sell, 150, 5 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 4, Side::Sell, 250, 5 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 5, Side::Buy, 98, 5 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 6, Side::Buy, 50, 5 });
+
+	ASSERT_TRUE(orderbook.AddOrder(Order{ OrderType::FillOrKill, 10, Side::Buy, 101, 11 }).empty());
+	ASSERT_TRUE(orderbook.AddOrder(Order{ OrderType::FillOrKill, 11, Side::Buy, 1000, 21 }).empty());
+	ASSERT_TRUE(orderbook.AddOrder(Order{ OrderType::FillOrKill, 12, Side::Sell, 60, 6 }).empty());
+	ASSERT_EQ(orderbook.Size(), 6);
+
+	ASSERT_EQ(orderbook.AddOrder(Order{ OrderType::FillOrKill, 13, Side::Buy, 150, 15 }).size(), 3);
+	ASSERT_EQ(orderbook.AddOrder(Order{ OrderType::FillOrKill, 14, Side::Buy, 260, 5 }).size(), 1);
+	ASSERT_EQ(orderbook.AddOrder(Order{ OrderType::FillOrKill, 15, Side::Sell, 50, 10 }).size(), 2);
+	ASSERT_EQ(orderbook.Size(), 0);
+}
+
+TEST(FillOrKillTests, ChecksDepthAcrossSparseLevelsOfAnySign)
+{
+	Orderbook orderbook;
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 1, Side::Sell, -20, 5 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 2, Side::Sell, 0, 5 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 3, Side::Sell, 30, 5 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 4, Side::Buy, -21, 5 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 5, Side::Buy, -40, 5 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 6, Side::Buy, std::numeric_limits<Price>::min(), 5 });
+	orderbook.CancelOrder(2);
+
+	ASSERT_TRUE(orderbook.AddOrder(Order{ OrderType::FillOrKill, 10, Side::Buy, 29, 6 }).empty());
+	ASSERT_TRUE(orderbook.AddOrder(Order{ OrderType::FillOrKill, 11, Side::Sell, -40, 11 }).empty());
+	ASSERT_EQ(orderbook.Size(), 5);
+
+	ASSERT_EQ(orderbook.AddOrder(Order{ OrderType::FillOrKill, 12, Side::Buy, 30, 10 }).size(), 2);
+	ASSERT_EQ(orderbook.AddOrder(Order{ OrderType::FillOrKill, 13, Side::Sell, std::numeric_limits<Price>::min(), 15 }).size(), 3);
+	ASSERT_EQ(orderbook.Size(), 0);
+}
+
+TEST(CommandBatchTests, MatchesSequentialCommands)
+{
+	OrderFlowGenerator generator{ OrderFlowSettings{ .seed_ = 11, .openingBurst_ = 100 } };
+	std::vector<OrderCommand> commands;
+	for (std::size_t index = 0; index < 5000; ++index)
+	{
+		commands.push_back(generator.Next().command_);
+	}
+
+	Orderbook sequential;
+	Trades expected;
+	for (const auto& command : commands)
+	{
+		const auto trades = sequential.ApplyCommand(command);
+		expected.insert(expected.end(), trades.begin(), trades.end());
+	}
+
+	Orderbook batched;
+	CommandResults results{ 64, 256 };
+	std::vector<Trade> actual;
+	for (std::size_t first = 0; first < commands.size(); first += 64)
+	{
+		const auto batch = std::span<const OrderCommand>{ commands }.subspan(first, std::min<std::size_t>(64, commands.size() - first));
+		batched.ApplyCommands(batch, results);
+		ASSERT_EQ(results.Size(), batch.size());
+
+		const auto& last = results.GetResults().back();
+		ASSERT_EQ(last.firstTrade_ + last.tradeCount_, results.GetTrades().size());
+		actual.insert(actual.end(), results.GetTrades().begin(), results.GetTrades().end());
+	}
+
+	ASSERT_FALSE(expected.empty());
+	ASSERT_EQ(actual.size(), expected.size());
+	for (std::size_t index = 0; index < expected.size(); ++index)
+	{
+		ASSERT_EQ(actual[index].GetBidTrade().orderId_, expected[index].GetBidTrade().orderId_);
+		ASSERT_EQ(actual[index].GetAskTrade().orderId_, expected[index].GetAskTrade().orderId_);
+		ASSERT_EQ(actual[index].GetBidTrade().quantity_, expected[index].GetBidTrade().quantity_);
+	}
+	ASSERT_EQ(batched.Size(), sequential.Size());
+
+	const std::array<OrderCommand, 6> outcomes{
+		OrderCommand::Add(Order{ OrderType::GoodTillCancel, 100'000, Side::Sell, 1'000, 5 }),
+		OrderCommand::Add(Order{ OrderType::GoodTillCancel, 100'000, Side::Sell, 1'000, 5 }),
+		OrderCommand::Add(Order{ OrderType::FillAndKill, 100'001, Side::Buy, 1'000, 8 }),
+		OrderCommand::Add(Order{ OrderType::GoodTillCancel, 100'002, Side::Sell, 1'001, 5 }),
+		OrderCommand::Cancel(100'002),
+		OrderCommand::Cancel(100'002),
+	};
+	Orderbook orderbook;
+	orderbook.ApplyCommands(outcomes, results);
+	ASSERT_EQ(results[0].outcome_, CommandOutcome::Rested);
+	ASSERT_EQ(results[1].outcome_, CommandOutcome::Rejected);
+	ASSERT_EQ(results[2].outcome_, CommandOutcome::Killed);
+	ASSERT_EQ(results[2].filledQuantity_, 5);
+	ASSERT_EQ(results.GetTrades(results[2]).size(), 1);
+	ASSERT_EQ(results[4].outcome_, CommandOutcome::Cancelled);
+	ASSERT_EQ(results[5].outcome_, CommandOutcome::NotFound);
+}
+
+
+TEST(AmendTests, ReductionsKeepPriorityAndOtherAmendsRequeue)
+{
+	Orderbook orderbook;
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 1, Side::Sell, 100, 10 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 2, Side::Sell, 100, 10 });
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 3, Side::Buy, 98, 10 });
+
+	ASSERT_TRUE(orderbook.ModifyOrder(OrderModify{ 1, Side::Sell, 100, 4 }).empty());
+	const auto reduced = orderbook.AddOrder(Order{ OrderType::FillAndKill, 10, Side::Buy, 100, 6 });
+	ASSERT_EQ(reduced.size(), 2);
+	ASSERT_EQ(reduced[0].GetAskTrade().orderId_, 1);
+	ASSERT_EQ(reduced[0].GetAskTrade().quantity_, 4);
+	ASSERT_EQ(reduced[1].GetAskTrade().orderId_, 2);
+
+	orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 4, Side::Sell, 100, 5 });
+	ASSERT_TRUE(orderbook.ModifyOrder(OrderModify{ 2, Side::Sell, 100, 20 }).empty());
+	const auto increased = orderbook.AddOrder(Order{ OrderType::FillAndKill, 11, Side::Buy, 100, 5 });
+	ASSERT_EQ(increased.size(), 1);
+	ASSERT_EQ(increased[0].GetAskTrade().orderId_, 4);
+
+	const auto repriced = orderbook.ModifyOrder(OrderModify{ 3, Side::Buy, 100, 30 });
+	ASSERT_EQ(repriced.size(), 1);
+	ASSERT_EQ(repriced[0].GetAskTrade().orderId_, 2);
+	ASSERT_EQ(repriced[0].GetBidTrade().quantity_, 20);
+
+	const auto infos = orderbook.GetOrderInfos();
+	ASSERT_EQ(orderbook.Size(), 1);
+	ASSERT_EQ(infos.GetBids()[0].price_, 100);
+	ASSERT_EQ(infos.GetBids()[0].quantity_, 10);
+	ASSERT_TRUE(infos.GetAsks().empty());
+}
+
+
+TEST(InstrumentationTests, ProbesRecordPhasesAndCountersPerCall)
+{
+	auto& instrumentation = Instrumentation::Get();
+	instrumentation.Reset();
+
+	ActiveProbe probe;
+	for (std::uint64_t call = 0; call < 3; ++call)
+	{
+		probe.Begin(ProbeOperation::Add, probe.Now());
+		probe.Mark(ProbePhase::Match);
+		probe.Count(ProbeCounter::Trades, call);
+		probe.End();
+	}
+
+	std::thread{ [&probe]
+		{
+			probe.Begin(ProbeOperation::Cancel, probe.Now());
+			probe.End();
+		} }.join();
+
+	const auto histograms = instrumentation.Collect();
+	ASSERT_EQ(histograms->operations_[static_cast<std::size_t>(ProbeOperation::Add)].GetCount(), 3);
+	ASSERT_EQ(histograms->operations_[static_cast<std::size_t>(ProbeOperation::Cancel)].GetCount(), 1);
+	ASSERT_EQ(histograms->phases_[static_cast<std::size_t>(ProbePhase::Match)].GetCount(), 4);
+	ASSERT_EQ(histograms->counters_[static_cast<std::size_t>(ProbeCounter::Trades)].GetMax(), 2);
+
+	std::ostringstream report;
+	instrumentation.Write(report);
+	ASSERT_NE(report.str().find("Trades"), std::string::npos);
+	static_assert(std::is_empty_v<NullProbe>);
+}
+
+
+TEST(OrderIdIndexTests, MatchesReferenceMapWithAndWithoutDenseWindow)
+{
+	for (const bool dense : { false, true })
+	{
+		OrderIdIndex index;
+		if (dense)
+		{
+			index.SetDenseWindow(1000, 2000);
+		}
+
+		std::unordered_map<OrderId, OrderHandle> reference;
+		std::mt19937_64 random{ 5 };
+		for (OrderHandle handle = 0; handle < 200000; ++handle)
+		{
+			// Note(vss): ids straddle the dense window, so both the window and the table see inserts, hits and misses.
+			const OrderId orderId = 500 + random() % 4000;
+			if (random() % 3 == 0)
+			{
+				const auto expected = reference.contains(orderId) ? reference.at(orderId) : OrderHandle{ Constants::InvalidHandle };
+				ASSERT_EQ(index.Erase(orderId), expected);
+				reference.erase(orderId);
+			}
+			else
+			{
+				ASSERT_EQ(index.Insert(orderId, handle), reference.try_emplace(orderId, handle).second);
+			}
+
+			const auto probe = 500 + random() % 4000;
+			const auto expected = reference.contains(probe) ? reference.at(probe) : OrderHandle{ Constants::InvalidHandle };
+			ASSERT_EQ(index.Find(probe), expected);
+			ASSERT_EQ(index.Size(), reference.size());
+		}
+	}
+}
+
+TEST(MemoryUsageTests, ReportsReservedRecordsAndGrownQueues)
+{
+	Orderbook orderbook{ 1024 };
+	const auto empty = orderbook.MemoryUsage();
+	ASSERT_EQ(empty.restingOrders_, 0);
+	ASSERT_GE(empty.orders_, 1024 * sizeof(RestingOrder));
+
+	for (OrderId orderId = 1; orderId <= 100; ++orderId)
+	{
+		orderbook.AddOrder(Order{ OrderType::GoodTillCancel, orderId, Side::Buy, 100, 10 });
+	}
+	orderbook.AddOrder(Order{ OrderType::FillAndKill, 101, Side::Sell, 100, 15 });
+
+	// Note(vss): the pool was reserved up front, only the level's queue outgrows its inline entries.
+	const auto usage = orderbook.MemoryUsage();
+	ASSERT_EQ(usage.restingOrders_, 99);
+	ASSERT_EQ(usage.orders_, empty.orders_);
+	ASSERT_GE(usage.levels_, empty.levels_ + 99 * sizeof(OrderQueue::Entry));
+	ASSERT_EQ(usage.Total(), usage.orders_ + usage.orderIndex_ + usage.levels_ + usage.expiries_);
+	// Note(vss): hot entry, cold record and index slot of a resting order fit in one cache line together.
+	ASSERT_LE(usage.bytesPerOrder_, 64);
+	ASSERT_EQ(orderbook.GetOrderInfos().GetBids().front().quantity_, 99 * 10 - 5);
+}
+
+TEST(SideTraitsTests, OrdersCrossesAndDispatchesPerSide)
+{
+	static_assert(SideTraits<Side::Buy>::Opposite == Side::Sell && SideTraits<Side::Sell>::Opposite == Side::Buy);
+	ASSERT_TRUE(SideTraits<Side::Buy>::Compare{}(101, 100));
+	ASSERT_TRUE(SideTraits<Side::Sell>::Compare{}(100, 101));
+
+	// Note(vss): a bid crosses asks at or below its limit, an ask crosses bids at or above it.
+	ASSERT_TRUE(SideTraits<Side::Buy>::Crosses(100, 100));
+	ASSERT_FALSE(SideTraits<Side::Buy>::Crosses(100, 101));
+	ASSERT_TRUE(SideTraits<Side::Sell>::Crosses(100, 101));
+	ASSERT_FALSE(SideTraits<Side::Sell>::Crosses(100, 99));
+
+	for (const auto side : { Side::Buy, Side::Sell })
+	{
+		ASSERT_EQ(DispatchSide(side, []<Side S>(SideConstant<S>) { return S; }), side);
+	}
+}
+
+TEST(LevelScanTests, SweepPricesMatchALevelWalk)
+{
+	std::mt19937 random{ 17 };
+	std::vector<LevelQuantity> quantities;
+	for (std::size_t count = 0; count < 40; ++count)
+	{
+		for (const std::uint64_t start : { std::uint64_t{}, std::uint64_t{ 50 } })
+		{
+			const auto target = start + random() % (count * 20 + 2);
+			std::uint64_t total{ start };
+			const auto index = FindCumulative(quantities.data(), quantities.size(), target, total);
+
+			std::uint64_t expectedTotal{ start };
+			auto expected = quantities.size();
+			for (std::size_t scanned = 0; scanned < quantities.size() && expected == quantities.size(); ++scanned)
+			{
+				expectedTotal += quantities[scanned];
+				expected = expectedTotal >= target ? scanned : expected;
+			}
+			ASSERT_EQ(index, expected);
+			ASSERT_EQ(total, expectedTotal);
+		}
+
+		std::array<std::uint32_t, 64> offsets{ };
+		const auto capacity = 1 + random() % (count + 1);
+		std::vector<std::uint32_t> expectedOffsets;
+		for (std::size_t scanned = 0; scanned < quantities.size() && expectedOffsets.size() < capacity; ++scanned)
+		{
+			if (quantities[scanned] != 0)
+			{
+				expectedOffsets.push_back(static_cast<std::uint32_t>(scanned));
+			}
+		}
+		const auto found = FindNonZero(quantities.data(), quantities.size(), offsets.data(), capacity);
+		ASSERT_EQ(std::vector<std::uint32_t>(offsets.begin(), offsets.begin() + found), expectedOffsets);
+
+		quantities.push_back(random() % 3 == 0 ? 0 : random() % 20);
+	}
+
+	// Note(vss): bids below 100 are out of band in both books, the second also rests off tick levels inside the band on both sides.
+	// Every ask tick from 200 to 498 holds quantity, so the full copy of the asks scans with FindNonZero, and the far ask leaves
+	// whole empty blocks for it to jump. The bid ladder is too short to scan and keeps the bitmap walk, as do the short copies.
+	for (const Price offTick : { 0, 1 })
+	{
+		Orderbook orderbook{ OrderbookSettings{ .ladder_ = LadderSettings{ 2, 100, 1300 } } };
+		std::map<Price, std::uint64_t, std::greater<Price>> bids;
+		std::map<Price, std::uint64_t> asks;
+		auto Add = [&](OrderId orderId, Side side, Price price, Quantity quantity)
+			{
+				orderbook.AddOrder(Order{ OrderType::GoodTillCancel, orderId, side, price, quantity });
+				(side == Side::Buy ? bids[price] : asks[price]) += quantity;
+			};
+
+		OrderId orderId{};
+		for (Price price = 200; price < 500; price += 2)
+		{
+			Add(++orderId, Side::Sell, price, static_cast<Quantity>(1 + random() % 10));
+		}
+		while (orderId < 550)
+		{
+			const auto side = orderId % 2 == 0 ? Side::Buy : Side::Sell;
+			const auto price = side == Side::Buy ? 10 + 2 * (random() % 95) + offTick * (orderId % 3 == 0) : 200 + 2 * (random() % 150);
+			Add(++orderId, side, static_cast<Price>(price), static_cast<Quantity>(1 + random() % 10));
+		}
+		Add(++orderId, Side::Sell, static_cast<Price>(756 + offTick), 7);
+
+		const auto infos = orderbook.GetOrderInfos();
+		ASSERT_TRUE(std::ranges::equal(infos.GetBids(), bids, [](const LevelInfo& level, const auto& expected) { return level.price_ == expected.first && level.quantity_ == expected.second; }));
+		ASSERT_TRUE(std::ranges::equal(infos.GetAsks(), asks, [](const LevelInfo& level, const auto& expected) { return level.price_ == expected.first && level.quantity_ == expected.second; }));
+
+		std::array<LevelInfo, 10> topBids{ };
+		std::array<LevelInfo, 10> topAsks{ };
+		const auto count = orderbook.GetDepth(topBids, topAsks);
+		ASSERT_EQ(count.bids_, topBids.size());
+		ASSERT_EQ(count.asks_, topAsks.size());
+		ASSERT_TRUE(std::equal(topBids.begin(), topBids.end(), infos.GetBids().begin(), [](const LevelInfo& level, const LevelInfo& expected) { return level.price_ == expected.price_ && level.quantity_ == expected.quantity_; }));
+		ASSERT_TRUE(std::equal(topAsks.begin(), topAsks.end(), infos.GetAsks().begin(), [](const LevelInfo& level, const LevelInfo& expected) { return level.price_ == expected.price_ && level.quantity_ == expected.quantity_; }));
+
+		for (const auto side : { Side::Buy, Side::Sell })
+		{
+			const auto& levels = side == Side::Buy ? infos.GetAsks() : infos.GetBids();
+			for (std::uint64_t quantity = 1; quantity < 650; quantity += 7)
+			{
+				std::optional<Price> expected;
+				std::uint64_t total{};
+				for (const auto& level : levels)
+				{
+					total += level.quantity_;
+					if (total >= quantity)
+					{
+						expected = level.price_;
+						break;
+					}
+				}
+				ASSERT_EQ(orderbook.GetSweepPrice(side, quantity), expected);
+			}
+		}
+	}
+}
+
+TEST(AuctionTests, CallPhaseAccumulatesAndUncrossesAtOnePrice)
+{
+	Orderbook orderbook;
+	orderbook.BeginAuction();
+	ASSERT_EQ(orderbook.GetSessionState(), SessionState::Auction);
+
+	// Note(vss): crossing orders rest instead of trading, orders that need a live opposite side are rejected.
+	for (const auto& order : { Order{ OrderType::GoodTillCancel, 1, Side::Buy, 102, 10 }, Order{ OrderType::GoodTillCancel, 2, Side::Buy, 101, 5 },
+		Order{ OrderType::GoodTillCancel, 3, Side::Buy, 99, 10 }, Order{ OrderType::GoodTillCancel, 4, Side::Sell, 98, 4 },
+		Order{ OrderType::GoodTillCancel, 5, Side::Sell, 100, 8 }, Order{ OrderType::GoodTillCancel, 6, Side::Sell, 101, 6 },
+		Order{ OrderType::FillAndKill, 7, Side::Buy, 105, 1 }, Order{ 8, Side::Sell, 1 } })
+	{
+		ASSERT_TRUE(orderbook.AddOrder(order).empty());
+	}
+	ASSERT_TRUE(orderbook.ModifyOrder(OrderModify{ 3, Side::Buy, 99, 10 }).empty());
+	ASSERT_EQ(orderbook.Size(), 6);
+
+	// Note(vss): 101 executes 15, more than any other price, with 3 bought at 101 or better left over.
+	const auto uncross = orderbook.GetIndicativeUncross();
+	ASSERT_TRUE(uncross.has_value());
+	ASSERT_EQ(uncross->price_, 101);
+	ASSERT_EQ(uncross->quantity_, 15);
+	ASSERT_EQ(uncross->GetImbalance(), 3);
+
+	const auto trades = orderbook.Uncross();
+	const std::vector<std::array<OrderId, 3>> expected{ { 1, 4, 4 }, { 1, 5, 6 }, { 2, 5, 2 }, { 2, 6, 3 } };
+	ASSERT_EQ(trades.size(), expected.size());
+	for (std::size_t index = 0; index < trades.size(); ++index)
+	{
+		ASSERT_EQ(trades[index].GetBidTrade().orderId_, expected[index][0]);
+		ASSERT_EQ(trades[index].GetAskTrade().orderId_, expected[index][1]);
+		ASSERT_EQ(trades[index].GetBidTrade().quantity_, expected[index][2]);
+		ASSERT_EQ(trades[index].GetBidTrade().price_, 101);
+		ASSERT_EQ(trades[index].GetAskTrade().price_, 101);
+	}
+
+	ASSERT_EQ(orderbook.GetSessionState(), SessionState::Continuous);
+	ASSERT_FALSE(orderbook.GetIndicativeUncross().has_value());
+	ASSERT_EQ(orderbook.Size(), 2);
+	ASSERT_EQ(orderbook.AddOrder(Order{ OrderType::GoodTillCancel, 9, Side::Buy, 101, 3 }).size(), 1);
+	orderbook.CancelOrder(3);
+
+	// Note(vss): equal volume and imbalance at 99 and 100, a sell surplus takes the lower price and a balanced book the higher one.
+	const std::array<OrderCommand, 5> commands{ OrderCommand::Uncross(), OrderCommand::BeginAuction(), OrderCommand::BeginAuction(),
+		OrderCommand::Add(Order{ OrderType::GoodTillCancel, 10, Side::Buy, 100, 5 }), OrderCommand::Add(Order{ OrderType::GoodTillCancel, 11, Side::Sell, 99, 8 }) };
+	CommandResults results;
+	orderbook.ApplyCommands(commands, results);
+	ASSERT_EQ(results[0].outcome_, CommandOutcome::Rejected);
+	ASSERT_EQ(results[1].outcome_, CommandOutcome::SessionChanged);
+	ASSERT_EQ(results[2].outcome_, CommandOutcome::Rejected);
+	ASSERT_EQ(results[4].outcome_, CommandOutcome::Rested);
+	ASSERT_EQ(orderbook.GetIndicativeUncross()->price_, 99);
+
+	orderbook.ModifyOrder(OrderModify{ 11, Side::Sell, 99, 5 });
+	ASSERT_EQ(orderbook.GetIndicativeUncross()->price_, 100);
+	ASSERT_EQ(orderbook.Uncross().size(), 1);
+}
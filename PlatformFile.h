@@ -0,0 +1,229 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <format>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/**
+* @brief Write only file that every Write appends to. Sync blocks until the written bytes are on stable storage.
+*/
+class AppendFile
+{
+public:
+
+	explicit AppendFile(const std::string& path)
+	{
+#if defined(_WIN32)
+		handle_ = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (handle_ == INVALID_HANDLE_VALUE)
+		{
+			throw std::logic_error(std::format("Cannot open ({}) for appending.", path));
+		}
+		SetFilePointerEx(handle_, LARGE_INTEGER{ }, nullptr, FILE_END);
+#else
+		descriptor_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		if (descriptor_ < 0)
+		{
+			throw std::logic_error(std::format("Cannot open ({}) for appending.", path));
+		}
+#endif
+	}
+
+	AppendFile(const AppendFile&) = delete;
+	void operator=(const AppendFile&) = delete;
+
+	~AppendFile()
+	{
+#if defined(_WIN32)
+		CloseHandle(handle_);
+#else
+		::close(descriptor_);
+#endif
+	}
+
+	void Write(std::span<const std::byte> data)
+	{
+		while (!data.empty())
+		{
+#if defined(_WIN32)
+			DWORD written{};
+			const auto chunk = static_cast<DWORD>(std::min<std::size_t>(data.size(), 1u << 30));
+			if (!WriteFile(handle_, data.data(), chunk, &written, nullptr))
+			{
+				throw std::logic_error("Append to file failed.");
+			}
+#else
+			const auto written = ::write(descriptor_, data.data(), data.size());
+			if (written < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				throw std::logic_error("Append to file failed.");
+			}
+#endif
+			data = data.subspan(static_cast<std::size_t>(written));
+		}
+	}
+
+	void Sync()
+	{
+#if defined(_WIN32)
+		const bool synced = FlushFileBuffers(handle_) != 0;
+#elif defined(__linux__)
+		const bool synced = ::fdatasync(descriptor_) == 0;
+#else
+		const bool synced = ::fsync(descriptor_) == 0;
+#endif
+		if (!synced)
+		{
+			throw std::logic_error("Syncing file to disk failed.");
+		}
+	}
+
+	std::uint64_t Size() const
+	{
+#if defined(_WIN32)
+		LARGE_INTEGER size{ };
+		GetFileSizeEx(handle_, &size);
+		return static_cast<std::uint64_t>(size.QuadPart);
+#else
+		struct stat status{ };
+		::fstat(descriptor_, &status);
+		return static_cast<std::uint64_t>(status.st_size);
+#endif
+	}
+
+	// Note(vss): cuts the file back to size, appends continue from the new end.
+	void Truncate(std::uint64_t size)
+	{
+#if defined(_WIN32)
+		LARGE_INTEGER end{ };
+		end.QuadPart = static_cast<LONGLONG>(size);
+		const bool truncated = SetFilePointerEx(handle_, end, nullptr, FILE_BEGIN) && SetEndOfFile(handle_);
+#else
+		const bool truncated = ::ftruncate(descriptor_, static_cast<off_t>(size)) == 0;
+#endif
+		if (!truncated)
+		{
+			throw std::logic_error(std::format("Truncating file to ({}) bytes failed.", size));
+		}
+	}
+
+private:
+
+#if defined(_WIN32)
+	HANDLE handle_{ INVALID_HANDLE_VALUE };
+#else
+	int descriptor_{ -1 };
+#endif
+};
+
+/**
+* @brief Read only view of a whole file mapped into memory. Pages are faulted in by the OS as they are touched,
+* so reading a file front to back runs at memory speed without copying it into a buffer first.
+*/
+class MappedFile
+{
+public:
+
+	explicit MappedFile(const std::string& path)
+	{
+#if defined(_WIN32)
+		const auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			throw std::logic_error(std::format("Cannot open ({}) for reading.", path));
+		}
+
+		LARGE_INTEGER size{ };
+		GetFileSizeEx(file, &size);
+		size_ = static_cast<std::size_t>(size.QuadPart);
+
+		if (size_ != 0)
+		{
+			const auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			data_ = mapping == nullptr ? nullptr : MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (mapping != nullptr)
+			{
+				CloseHandle(mapping);
+			}
+		}
+		CloseHandle(file);
+#else
+		const auto descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (descriptor < 0)
+		{
+			throw std::logic_error(std::format("Cannot open ({}) for reading.", path));
+		}
+
+		struct stat status{ };
+		::fstat(descriptor, &status);
+		size_ = static_cast<std::size_t>(status.st_size);
+
+		if (size_ != 0)
+		{
+			data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor, 0);
+			if (data_ == MAP_FAILED)
+			{
+				data_ = nullptr;
+			}
+			else
+			{
+				::madvise(data_, size_, MADV_SEQUENTIAL);
+			}
+		}
+		::close(descriptor);
+#endif
+
+		if (size_ != 0 && data_ == nullptr)
+		{
+			throw std::logic_error(std::format("Cannot map ({}) into memory.", path));
+		}
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	void operator=(const MappedFile&) = delete;
+
+	~MappedFile()
+	{
+		if (data_ == nullptr)
+		{
+			return;
+		}
+
+#if defined(_WIN32)
+		UnmapViewOfFile(data_);
+#else
+		::munmap(data_, size_);
+#endif
+	}
+
+	std::span<const std::byte> GetData() const { return { static_cast<const std::byte*>(data_), size_ }; }
+
+private:
+
+	void* data_{ nullptr };
+	std::size_t size_{};
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory_resource>
+
+#include "Aliases.h"
+#include "OrderPool.h"
+
+/**
+* @brief Aggregates of one price level, kept up to date on every add, cancel and fill
+* so that depth can be read without touching the individual orders.
+*/
+struct LevelData
+{
+	LevelQuantity quantity_{};
+	LevelQuantity count_{};
+
+	enum class Action
+	{
+		Add,
+		Remove,
+		Match,
+		Reduce,
+	};
+};
+
+// Note(vss): allocator aware, so the pmr containers of BookSide pass their resource down to the level's queue.
+struct PriceLevel
+{
+	using allocator_type = std::pmr::polymorphic_allocator<>;
+
+	PriceLevel() = default;
+
+	explicit PriceLevel(const allocator_type& allocator) :
+		orders_{ allocator }
+	{}
+
+	PriceLevel(const PriceLevel& other, const allocator_type& allocator) :
+		orders_{ other.orders_, allocator },
+		data_{ other.data_ }
+	{}
+
+	OrderQueue orders_;
+	LevelData data_;
+
+	bool Empty() const { return orders_.Empty(); }
+};
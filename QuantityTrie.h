@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <numeric>
+#include <type_traits>
+
+#include "Aliases.h"
+
+/**
+* @brief Resting quantity summed over arbitrary prices: a trie over the price a byte at a time in which every node holds the
+* quantity resting under each of its 256 children. A change at one price and the quantity below a limit each walk a single
+* root to leaf path, four nodes for 32 bit prices and two for 16 bit ones, however many prices are held. A node is released
+* as soon as nothing rests under it, so the trie only ever holds the paths of prices that currently have quantity.
+*/
+class QuantityTrie
+{
+public:
+
+	QuantityTrie() :
+		nodes_(1)
+	{}
+
+	std::uint64_t GetQuantity() const { return quantity_; }
+
+	// Note(vss): change is negative for cancels and fills, a price is never taken below zero.
+	void Add(Price price, std::int64_t change)
+	{
+		if (change == 0)
+		{
+			return;
+		}
+
+		const auto key = ToKey(price);
+		quantity_ += static_cast<std::uint64_t>(change);
+
+		auto node = Root;
+		for (auto shift = TopShift;; shift -= DigitBits)
+		{
+			const auto digit = ToDigit(key, shift);
+			const auto quantity = nodes_[node].quantities_[digit] += static_cast<std::uint64_t>(change);
+			if (shift == 0)
+			{
+				return;
+			}
+
+			auto child = nodes_[node].children_[digit];
+			if (quantity == 0)
+			{
+				// Note(vss): nothing rests anywhere else under child, so the rest of the path is all that is left of its subtree.
+				nodes_[node].children_[digit] = NoNode;
+				Release(child, key, shift);
+				return;
+			}
+			if (child == NoNode)
+			{
+				child = Allocate();
+				nodes_[node].children_[digit] = child;
+			}
+			node = child;
+		}
+	}
+
+	// Note(vss): quantity resting at prices below limit, and at limit itself when inclusive.
+	std::uint64_t GetQuantityBelow(Price limit, bool inclusive) const
+	{
+		const auto key = ToKey(limit);
+		std::uint64_t quantity{};
+
+		auto node = Root;
+		for (auto shift = TopShift;; shift -= DigitBits)
+		{
+			const auto& quantities = nodes_[node].quantities_;
+			const auto digit = ToDigit(key, shift);
+			quantity = std::accumulate(quantities.begin(), quantities.begin() + digit, quantity);
+			if (shift == 0)
+			{
+				return inclusive ? quantity + quantities[digit] : quantity;
+			}
+
+			node = nodes_[node].children_[digit];
+			if (node == NoNode)
+			{
+				return quantity;
+			}
+		}
+	}
+
+	std::size_t MemoryUsage() const { return nodes_.capacity() * sizeof(Node) + free_.capacity() * sizeof(std::uint32_t); }
+
+private:
+
+	using Key = std::make_unsigned_t<Price>;
+
+	static constexpr unsigned DigitBits = 8;
+	static constexpr std::size_t Fanout = std::size_t{ 1 } << DigitBits;
+	static constexpr unsigned KeyBits = std::numeric_limits<Key>::digits;
+	static constexpr unsigned TopShift = KeyBits - DigitBits;
+	static_assert(KeyBits % DigitBits == 0, "Every level of the trie takes a whole digit of the price.");
+
+	static constexpr std::uint32_t Root = 0;
+	// Note(vss): the root is nobody's child, so its index doubles as the missing child marker.
+	static constexpr std::uint32_t NoNode = Root;
+
+	struct Node
+	{
+		std::array<std::uint64_t, Fanout> quantities_{};
+		std::array<std::uint32_t, Fanout> children_{};
+	};
+
+	std::vector<Node> nodes_;
+	std::vector<std::uint32_t> free_;
+	std::uint64_t quantity_{};
+
+	// Note(vss): flipping the sign bit keeps negative prices below positive ones in unsigned order.
+	static Key ToKey(Price price) { return static_cast<Key>(static_cast<Key>(price) ^ (Key{ 1 } << (KeyBits - 1))); }
+	static std::size_t ToDigit(Key key, unsigned shift) { return static_cast<std::size_t>(key >> shift) & (Fanout - 1); }
+
+	std::uint32_t Allocate()
+	{
+		if (free_.empty())
+		{
+			nodes_.emplace_back();
+			return static_cast<std::uint32_t>(nodes_.size() - 1);
+		}
+
+		const auto node = free_.back();
+		free_.pop_back();
+		return node;
+	}
+
+	// Note(vss): node is the child taken at shift along the path of key, every node under it on that path is released with it.
+	void Release(std::uint32_t node, Key key, unsigned shift)
+	{
+		while (node != NoNode)
+		{
+			shift -= DigitBits;
+			const auto next = shift == 0 ? NoNode : nodes_[node].children_[ToDigit(key, shift)];
+			nodes_[node] = Node{ };
+			free_.push_back(node);
+			node = next;
+		}
+	}
+};
\ No newline at end of file
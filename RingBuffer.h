@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+// Note(vss): fixed rather than std::hardware_destructive_interference_size, which differs between compilers and flags.
+inline constexpr std::size_t CacheLineSize = 64;
+
+/**
+* @brief Bounded single producer, single consumer queue.
+* Each side caches the other side's index, so the shared counters are only re-read when the queue looks full or empty.
+*/
+template <typename T, std::size_t Capacity>
+class SpscRingBuffer
+{
+	static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+public:
+
+	SpscRingBuffer() : slots_{ std::make_unique<T[]>(Capacity) } {}
+
+	SpscRingBuffer(const SpscRingBuffer&) = delete;
+	void operator=(const SpscRingBuffer&) = delete;
+
+	bool TryPush(const T& value)
+	{
+		const auto head = head_.load(std::memory_order_relaxed);
+		if (head - cachedTail_ == Capacity)
+		{
+			cachedTail_ = tail_.load(std::memory_order_acquire);
+			if (head - cachedTail_ == Capacity)
+			{
+				return false;
+			}
+		}
+
+		slots_[head & Mask] = value;
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool TryPop(T& value)
+	{
+		const auto tail = tail_.load(std::memory_order_relaxed);
+		if (tail == cachedHead_)
+		{
+			cachedHead_ = head_.load(std::memory_order_acquire);
+			if (tail == cachedHead_)
+			{
+				return false;
+			}
+		}
+
+		value = slots_[tail & Mask];
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+
+	static constexpr std::size_t Mask = Capacity - 1;
+
+	std::unique_ptr<T[]> slots_;
+	alignas(CacheLineSize) std::atomic<std::size_t> head_{};
+	std::size_t cachedTail_{};
+	alignas(CacheLineSize) std::atomic<std::size_t> tail_{};
+	std::size_t cachedHead_{};
+};
+
+/**
+* @brief Bounded multi producer, single consumer queue.
+* Producers claim a slot with a compare and swap on the head, every slot carries a sequence number
+* that tells producers and the consumer whether it is free or published.
+*/
+template <typename T, std::size_t Capacity>
+class MpscRingBuffer
+{
+	static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+public:
+
+	MpscRingBuffer() : slots_{ std::make_unique<Slot[]>(Capacity) }
+	{
+		for (std::size_t index = 0; index < Capacity; ++index)
+		{
+			slots_[index].sequence_.store(index, std::memory_order_relaxed);
+		}
+	}
+
+	MpscRingBuffer(const MpscRingBuffer&) = delete;
+	void operator=(const MpscRingBuffer&) = delete;
+
+	bool TryPush(const T& value)
+	{
+		auto head = head_.load(std::memory_order_relaxed);
+
+		while (true)
+		{
+			auto& slot = slots_[head & Mask];
+			const auto sequence = slot.sequence_.load(std::memory_order_acquire);
+			const auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(head);
+
+			if (difference == 0)
+			{
+				if (head_.compare_exchange_weak(head, head + 1, std::memory_order_relaxed))
+				{
+					slot.value_ = value;
+					slot.sequence_.store(head + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0)
+			{
+				return false;
+			}
+			else
+			{
+				head = head_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool TryPop(T& value)
+	{
+		auto& slot = slots_[tail_ & Mask];
+		if (slot.sequence_.load(std::memory_order_acquire) != tail_ + 1)
+		{
+			return false;
+		}
+
+		value = slot.value_;
+		slot.sequence_.store(tail_ + Capacity, std::memory_order_release);
+		++tail_;
+		return true;
+	}
+
+private:
+
+	struct Slot
+	{
+		std::atomic<std::size_t> sequence_{};
+		T value_{};
+	};
+
+	static constexpr std::size_t Mask = Capacity - 1;
+
+	std::unique_ptr<Slot[]> slots_;
+	alignas(CacheLineSize) std::atomic<std::size_t> head_{};
+	alignas(CacheLineSize) std::size_t tail_{};
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "RingBuffer.h"
+#include "WaitStrategy.h"
+
+/**
+* @brief Publishes a value from one writer to any number of readers without blocking the writer.
+* The writer bumps the sequence to odd, stores the value and bumps it back to even. A reader copies the value and
+* retries if the sequence was odd or moved meanwhile, so readers never slow the writer down, they only repeat their copy.
+* The value is kept as atomic words, so a torn copy is discarded instead of being a data race.
+*/
+template <typename T>
+class SeqLock
+{
+	static_assert(std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>, "SeqLock needs a trivially copyable value.");
+
+public:
+
+	SeqLock() = default;
+
+	SeqLock(const SeqLock&) = delete;
+	void operator=(const SeqLock&) = delete;
+
+	// Note(vss): only one thread may store at a time.
+	void Store(const T& value)
+	{
+		std::array<std::uint64_t, WordCount> words{ };
+		std::memcpy(words.data(), &value, sizeof(T));
+
+		const auto sequence = sequence_.load(std::memory_order_relaxed);
+		sequence_.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for (std::size_t index = 0; index < WordCount; ++index)
+		{
+			words_[index].store(words[index], std::memory_order_relaxed);
+		}
+
+		sequence_.store(sequence + 2, std::memory_order_release);
+	}
+
+	T Load() const
+	{
+		std::array<std::uint64_t, WordCount> words{ };
+
+		while (true)
+		{
+			const auto sequence = sequence_.load(std::memory_order_acquire);
+			if (sequence & 1)
+			{
+				CpuRelax();
+				continue;
+			}
+
+			for (std::size_t index = 0; index < WordCount; ++index)
+			{
+				words[index] = words_[index].load(std::memory_order_relaxed);
+			}
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (sequence_.load(std::memory_order_relaxed) == sequence)
+			{
+				break;
+			}
+		}
+
+		T value;
+		std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+		return value;
+	}
+
+private:
+
+	static constexpr std::size_t WordCount = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+	alignas(CacheLineSize) std::atomic<std::uint64_t> sequence_{};
+	std::array<std::atomic<std::uint64_t>, WordCount> words_{ };
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <functional>
+#include <type_traits>
+
+#include "Side.h"
+#include "Aliases.h"
+
+/**
+* @brief What differs between bids and asks, resolved at compile time. Book code written against SideTraits<S> is instantiated
+* once per side, so matching, resting and cancelling never test a Side at run time once a command has picked its side.
+*/
+template <Side S>
+struct SideTraits
+{
+	static constexpr Side Opposite = S == Side::Buy ? Side::Sell : Side::Buy;
+
+	// Note(vss): the better price for this side comes first, bids descend and asks ascend.
+	using Compare = std::conditional_t<S == Side::Buy, std::greater<Price>, std::less<Price>>;
+
+	// Note(vss): true if an order on this side limited at price trades with a resting order at restingPrice.
+	static constexpr bool Crosses(Price price, Price restingPrice)
+	{
+		return S == Side::Buy ? restingPrice <= price : restingPrice >= price;
+	}
+};
+
+template <Side S>
+using SideConstant = std::integral_constant<Side, S>;
+
+/**
+* @brief Calls function with the SideConstant of side, the one place a run time Side turns into a template argument.
+* Callers pass a lambda of the form []<Side S>(SideConstant<S>) { ... }.
+*/
+template <typename Function>
+decltype(auto) DispatchSide(Side side, Function&& function)
+{
+	if (side == Side::Buy)
+	{
+		return function(SideConstant<Side::Buy>{ });
+	}
+	return function(SideConstant<Side::Sell>{ });
+}
\ No newline at end of file
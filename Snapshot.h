@@ -0,0 +1,136 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <format>
+
+#include "Aliases.h"
+#include "PlatformFile.h"
+
+/**
+* @brief A book snapshot is a SnapshotHeader followed by every level, bids best first and then asks best first.
+* Each SnapshotLevel is directly followed by its orders in time priority, so loading never has to sort or match anything.
+* sequence_ is the journal sequence the snapshot covers, replaying the journal past it brings the book up to date.
+*/
+struct SnapshotHeader
+{
+	static constexpr std::uint32_t Magic = 0x534a424f; // Note(vss): "OBJS".
+	// Note(vss): version 2 added the expiry of every order, version 3 the session state.
+	static constexpr std::uint32_t Version = 3;
+
+	std::uint32_t magic_{ Magic };
+	std::uint32_t version_{ Version };
+	std::uint64_t sequence_{};
+	std::uint64_t levelCount_{};
+	std::uint64_t orderCount_{};
+	std::uint8_t sessionState_{};
+	std::uint8_t reserved_[7]{ };
+};
+
+struct SnapshotLevel
+{
+	std::int32_t price_{};
+	std::uint8_t side_{};
+	std::uint8_t reserved_[3]{ };
+	std::uint32_t quantity_{};
+	std::uint32_t count_{};
+};
+
+struct SnapshotOrder
+{
+	OrderId orderId_{};
+	Timestamp expiry_{};
+	std::uint32_t initialQuantity_{};
+	std::uint32_t remainingQuantity_{};
+	std::uint8_t orderType_{};
+	std::uint8_t reserved_[7]{ };
+};
+
+static_assert(sizeof(SnapshotHeader) == 40 && sizeof(SnapshotLevel) == 16 && sizeof(SnapshotOrder) == 32,
+	"Snapshot records are an on disk format, their layout must not change.");
+
+template <typename Record>
+void AppendSnapshotRecord(std::vector<std::byte>& buffer, const Record& record)
+{
+	const auto bytes = std::as_bytes(std::span{ &record, 1 });
+	buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+}
+
+/**
+* @brief Maps a snapshot file and checks up front that its levels and orders add up to exactly the size of the file.
+*/
+class SnapshotReader
+{
+public:
+
+	explicit SnapshotReader(const std::string& path) :
+		file_{ path },
+		data_{ file_.GetData() }
+	{
+		if (data_.size() < sizeof(header_))
+		{
+			throw std::logic_error(std::format("Snapshot ({}) is missing its header.", path));
+		}
+
+		std::memcpy(&header_, data_.data(), sizeof(header_));
+		if (header_.magic_ != SnapshotHeader::Magic || header_.version_ != SnapshotHeader::Version)
+		{
+			throw std::logic_error(std::format("({}) is not a version {} snapshot.", path, SnapshotHeader::Version));
+		}
+
+		std::uint64_t orderCount{};
+		auto offset = sizeof(header_);
+		for (std::uint64_t index = 0; index < header_.levelCount_ && offset + sizeof(SnapshotLevel) <= data_.size(); ++index)
+		{
+			const auto level = Read<SnapshotLevel>(offset);
+			orderCount += level.count_;
+			offset += sizeof(SnapshotLevel) + level.count_ * sizeof(SnapshotOrder);
+		}
+
+		if (orderCount != header_.orderCount_ || offset != data_.size())
+		{
+			throw std::logic_error(std::format("Snapshot ({}) is truncated or corrupt.", path));
+		}
+	}
+
+	const SnapshotHeader& GetHeader() const { return header_; }
+
+	/**
+	* @brief Calls onLevel(const SnapshotLevel&) for every level, followed by onOrder(const SnapshotOrder&) for each of its orders.
+	*/
+	template <typename LevelFunction, typename OrderFunction>
+	void ForEach(LevelFunction&& onLevel, OrderFunction&& onOrder) const
+	{
+		auto offset = sizeof(header_);
+		for (std::uint64_t index = 0; index < header_.levelCount_; ++index)
+		{
+			const auto level = Read<SnapshotLevel>(offset);
+			offset += sizeof(SnapshotLevel);
+			onLevel(level);
+
+			for (std::uint32_t order = 0; order < level.count_; ++order, offset += sizeof(SnapshotOrder))
+			{
+				onOrder(Read<SnapshotOrder>(offset));
+			}
+		}
+	}
+
+private:
+
+	MappedFile file_;
+	std::span<const std::byte> data_;
+	SnapshotHeader header_;
+
+	template <typename Record>
+	Record Read(std::size_t offset) const
+	{
+		Record record;
+		std::memcpy(&record, data_.data() + offset, sizeof(record));
+		return record;
+	}
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <thread>
+#include <cstddef>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/**
+* @brief Restricts a thread to a single logical core. Returns false if the platform refused or is unsupported.
+*/
+inline bool PinThreadToCore(std::jthread& thread, std::size_t core)
+{
+#if defined(_WIN32)
+	if (core >= sizeof(DWORD_PTR) * 8)
+	{
+		return false;
+	}
+	return SetThreadAffinityMask(thread.native_handle(), DWORD_PTR{ 1 } << core) != 0;
+#elif defined(__linux__)
+	if (core >= CPU_SETSIZE)
+	{
+		return false;
+	}
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(core, &cpus);
+	return pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus) == 0;
+#else
+	(void)thread;
+	(void)core;
+	return false;
+#endif
+}
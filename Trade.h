@@ -11,6 +11,8 @@ class Trade
 {
 public:
 
+	Trade() = default;
+
 	Trade(const TradeInfo& bidTrade, const TradeInfo& askTrade) :
 		bidTrade_{ bidTrade },
 		askTrade_{ askTrade }
@@ -21,8 +23,8 @@ public:
 
 private:
 
-	TradeInfo bidTrade_;
-	TradeInfo askTrade_;
+	TradeInfo bidTrade_{ };
+	TradeInfo askTrade_{ };
 };
 
 using Trades = std::vector<Trade>;
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <span>
+#include <algorithm>
+#include <concepts>
+
+#include "Trade.h"
+
+/**
+* @brief Anything that can be called with each Trade as it is executed. Sinks are template parameters of the book,
+* so the call is resolved at compile time and usually inlined into the matching loop.
+*/
+template <typename Sink>
+concept TradeSink = std::invocable<Sink&, const Trade&>;
+
+/**
+* @brief Writes trades into a buffer owned by the caller. Trades that no longer fit are counted, not stored,
+* since an execution cannot be undone once the orders have been filled.
+*/
+class TradeSpanSink
+{
+public:
+
+	explicit TradeSpanSink(std::span<Trade> trades) :
+		trades_{ trades }
+	{}
+
+	void operator()(const Trade& trade)
+	{
+		if (size_ < trades_.size())
+		{
+			trades_[size_] = trade;
+		}
+		else
+		{
+			++dropped_;
+		}
+		++size_;
+	}
+
+	std::span<const Trade> GetTrades() const { return trades_.first(std::min(size_, trades_.size())); }
+	std::size_t GetDropped() const { return dropped_; }
+	void Clear() { size_ = 0; dropped_ = 0; }
+
+private:
+
+	std::span<Trade> trades_;
+	std::size_t size_{};
+	std::size_t dropped_{};
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+inline void CpuRelax()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	_mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	asm volatile("yield");
+#endif
+}
+
+/**
+* @brief A consumer that runs out of work calls Wait with the signal value it saw before draining,
+* producers call Notify after publishing. Signal is bumped on every Notify.
+*/
+struct BusySpinWaitStrategy
+{
+	// Note(vss): never sleeps, the consumer keeps its core and reacts within nanoseconds.
+	void Wait(const std::atomic<std::uint64_t>&, std::uint64_t) const { CpuRelax(); }
+	void Notify(std::atomic<std::uint64_t>&) const { }
+};
+
+struct BlockingWaitStrategy
+{
+	// Note(vss): parks the consumer in the kernel until the signal moves, trading wake up latency for an idle core.
+	void Wait(const std::atomic<std::uint64_t>& signal, std::uint64_t observed) const
+	{
+		signal.wait(observed, std::memory_order_acquire);
+	}
+
+	void Notify(std::atomic<std::uint64_t>& signal) const
+	{
+		signal.fetch_add(1, std::memory_order_release);
+		signal.notify_one();
+	}
+};